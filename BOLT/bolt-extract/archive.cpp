@@ -0,0 +1,116 @@
+#include <stdexcept>
+#include <format>
+
+#include "archive.h"
+
+
+using namespace BOLT;
+
+bolt_archive_t::bolt_archive_t(const std::filesystem::path& filename, algorithm_t algorithm, std::endian byte_order, std::size_t cache_budget, std::size_t archive_index)
+  : reader(algorithm, byte_order), cache_budget(cache_budget) {
+  reader.read_from_file(filename);
+
+  if (archive_index >= reader.archives().size()) {
+    throw std::runtime_error(std::format("Archive {} requested but only {} found in {}", archive_index, reader.archives().size(), filename.string()));
+  }
+  bolt_begin = reader.archives()[archive_index];
+  decoder.emplace(reader.data(), bolt_begin, algorithm, byte_order);
+  decoder->set_quiet(true);  // errors go back with the handle instead
+}
+
+const entry_t* bolt_archive_t::entry_at(std::uint32_t offset, std::uint32_t count) const {
+  std::span<const std::byte> rom = reader.data();
+  std::size_t table = bolt_begin + offset;
+  if (table > rom.size() || (rom.size() - table) / sizeof(entry_t) < count) {
+    throw std::runtime_error(std::format("Folder table at BOLT+{:X} lies outside the rom", offset));
+  }
+  return reinterpret_cast<const entry_t*>(&rom[table]);
+}
+
+folder_t bolt_archive_t::root() const {
+  const archive_t* header = reinterpret_cast<const archive_t*>(&reader.data()[bolt_begin]);
+  return folder_t{ header->entries, reader.get_num_entries(header) };
+}
+
+folder_t bolt_archive_t::open_folder(const folder_t& parent, std::uint32_t index) const {
+  if (index >= parent.size() || !parent.is_folder(index)) {
+    throw std::runtime_error(std::format("Entry {:03X} is not a folder", index));
+  }
+  const entry_t& entry = parent[index];
+  std::uint32_t size = reader.get_dir_size(entry);
+  return folder_t{ entry_at(entry.data_offset(reader.get_byte_order()), size), size };
+}
+
+entry_ref_t bolt_archive_t::load(const folder_t& folder, std::uint32_t index) {
+  if (index >= folder.size() || folder.is_folder(index)) {
+    throw std::runtime_error(std::format("Entry {:03X} is not a file", index));
+  }
+  return load(folder[index]);
+}
+
+entry_ref_t bolt_archive_t::load(const entry_t& entry) {
+  std::lock_guard guard{ lock };
+
+  // Stored data is already sitting in the mapping, nothing to cache
+  if (entry.flags & FLAG_UNCOMPRESSED) {
+    std::span<const std::byte> result = decoder->decode(entry);
+    return entry_ref_t{ nullptr, result, decoder->last_error() };
+  }
+
+  std::endian order = reader.get_byte_order();
+  cache_key_t key{ bolt_begin + entry.data_offset(order), entry.flags, entry.uncompressed_size(order) };
+  auto found = cache_index.find(key);
+  if (found != cache_index.end()) {
+    cache_hits++;
+    lru.splice(lru.begin(), lru, found->second);
+    const cache_slot_t& slot = *found->second;
+    return entry_ref_t{ slot.data, *slot.data, slot.error };
+  }
+
+  cache_misses++;
+  std::span<const std::byte> result = decoder->decode(entry);
+  auto data = std::make_shared<const std::vector<std::byte>>(result.begin(), result.end());
+
+  lru.push_front({ key, data, decoder->last_error() });
+  cache_index[key] = lru.begin();
+  cache_bytes += data->size();
+  evict_to_budget();
+
+  return entry_ref_t{ data, *data, decoder->last_error() };
+}
+
+void bolt_archive_t::evict_to_budget() {
+  // Entries with live handles are pinned, like num_instances keeps an archive open in the game
+  auto it = lru.end();
+  while (cache_bytes > cache_budget && it != lru.begin()) {
+    --it;
+    if (it->data.use_count() > 1) continue;
+
+    cache_bytes -= it->data->size();
+    cache_index.erase(it->key);
+    it = lru.erase(it);
+  }
+}
+
+void bolt_archive_t::trim() {
+  std::lock_guard guard{ lock };
+  std::size_t budget = cache_budget;
+  cache_budget = 0;
+  evict_to_budget();
+  cache_budget = budget;
+}
+
+std::size_t bolt_archive_t::cached_bytes() {
+  std::lock_guard guard{ lock };
+  return cache_bytes;
+}
+
+std::size_t bolt_archive_t::hits() {
+  std::lock_guard guard{ lock };
+  return cache_hits;
+}
+
+std::size_t bolt_archive_t::misses() {
+  std::lock_guard guard{ lock };
+  return cache_misses;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include "bolt.h"
+#include "decoder.h"
+
+
+namespace BOLT {
+  // A decoded entry. The data stays alive as long as any copy of the handle does, and the cache
+  // won't evict it meanwhile. Stored entries point straight into the mapped rom.
+  class entry_ref_t {
+  private:
+    std::shared_ptr<const std::vector<std::byte>> owner;
+    std::span<const std::byte> bytes;
+    decode_error_t decode_error;
+
+  public:
+    std::span<const std::byte> data() const { return bytes; }
+    std::size_t size() const { return bytes.size(); }
+    explicit operator bool() const { return bytes.data() != nullptr; }
+
+    // Why the data is short or damaged, if it is. Kept with cached entries too.
+    const decode_error_t& error() const { return decode_error; }
+
+    entry_ref_t() = default;
+    entry_ref_t(std::shared_ptr<const std::vector<std::byte>> owner, std::span<const std::byte> bytes, const decode_error_t& decode_error)
+      : owner(std::move(owner)), bytes(bytes), decode_error(decode_error) {}
+  };
+
+  // One level of the archive's entry tree, like BOLTFolder/BOLTEntryList in the game
+  class folder_t {
+  private:
+    const entry_t* entries = nullptr;
+    std::uint32_t num_entries = 0;
+
+  public:
+    std::uint32_t size() const { return num_entries; }
+    const entry_t& operator[](std::uint32_t index) const { return entries[index]; }
+
+    // Zero in either byte order
+    bool is_folder(std::uint32_t index) const { return entries[index].file_hash_be == 0; }
+
+    folder_t() = default;
+    folder_t(const entry_t* entries, std::uint32_t num_entries)
+      : entries(entries), num_entries(num_entries) {}
+  };
+
+  // Random access to the entries of one archive, modelled on the game's own BOLTArchive. Opening
+  // maps the rom once; decoded entries are kept in an LRU cache limited to cache_budget bytes.
+  // All members may be called from several threads.
+  class bolt_archive_t {
+  private:
+    // Entries sharing data_offset, flags and size decode to the same bytes, the same key extract_batch uses
+    using cache_key_t = std::tuple<std::size_t, std::uint8_t, std::uint32_t>;
+
+    struct cache_slot_t {
+      cache_key_t key;
+      std::shared_ptr<const std::vector<std::byte>> data;
+      decode_error_t error;
+    };
+
+    bolt_reader_t reader;
+    std::size_t bolt_begin = 0;
+
+    std::mutex lock;
+    std::optional<decoder_t> decoder;
+
+    // Most recently used at the front
+    std::list<cache_slot_t> lru;
+    std::map<cache_key_t, std::list<cache_slot_t>::iterator> cache_index;
+    std::size_t cache_budget;
+    std::size_t cache_bytes = 0;
+
+    std::size_t cache_hits = 0;
+    std::size_t cache_misses = 0;
+
+    // Throws if the count entries at offset don't all lie inside the rom
+    const entry_t* entry_at(std::uint32_t offset, std::uint32_t count) const;
+    void evict_to_budget();
+
+  public:
+    folder_t root() const;
+    folder_t open_folder(const folder_t& parent, std::uint32_t index) const;
+
+    // Decoded data of a file entry, from the cache if it is still there
+    entry_ref_t load(const entry_t& entry);
+    entry_ref_t load(const folder_t& folder, std::uint32_t index);
+
+    // Drops everything that isn't referenced by a live handle
+    void trim();
+
+    std::size_t cached_bytes();
+    std::size_t hits();
+    std::size_t misses();
+
+    // archive_index picks one archive when the rom holds several, in file order
+    bolt_archive_t(const std::filesystem::path& filename, algorithm_t algorithm, std::endian byte_order, std::size_t cache_budget = 64 * 1024 * 1024, std::size_t archive_index = 0);
+  };
+}
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "archive.h"
+#include "bench.h"
+#include "corpus.h"
+#include "decoder.h"
+#include "stream_decoder.h"
+#include "util.h"
+
+
+using namespace BOLT;
+
+namespace {
+  struct timing_t {
+    double median;
+    double min;
+    double max;
+  };
+
+  // One untimed warm-up, then reps timed runs. setup runs before each one, outside the clock.
+  template<class setup_t, class fn_t>
+  timing_t measure(unsigned reps, setup_t setup, fn_t fn) {
+    setup();
+    fn();
+
+    std::vector<double> seconds;
+    for (unsigned i = 0; i < std::max(reps, 1u); ++i) {
+      setup();
+      auto start = std::chrono::steady_clock::now();
+      fn();
+      seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(seconds.begin(), seconds.end());
+    return { seconds[seconds.size() / 2], seconds.front(), seconds.back() };
+  }
+
+  void print_header() {
+    std::cout << std::format("{:<6}{:<9}{:>10}{:>10}{:>8}{:>10}{:>10}{:>12}{:>9}{:>9}{:>11}{:>12}\n",
+      "codec", "shape", "in MiB", "out MiB", "ratio", "MB/s", "Mtok/s", "ns/entry", "entries", "spread", "checks", "extract ms");
+  }
+
+  // decode is the bounds checked decoder, unchecked the same entries without checks
+  void print_row(const char* codec, const char* shape, std::size_t in_bytes, std::size_t out_bytes, std::uint64_t tokens, std::size_t entries, const timing_t& decode, const timing_t& unchecked, const timing_t& extract) {
+    double mib = 1024.0 * 1024.0;
+    double spread = decode.median > 0 ? 100.0 * (decode.max - decode.min) / decode.median : 0.0;
+    double check_cost = unchecked.median > 0 ? 100.0 * (decode.median / unchecked.median - 1.0) : 0.0;
+    std::cout << std::format("{:<6}{:<9}{:>10.2f}{:>10.2f}{:>8.2f}{:>10.1f}{:>10.1f}{:>12.0f}{:>9}{:>8.1f}%{:>10.1f}%{:>12.1f}\n",
+      codec, shape, in_bytes / mib, out_bytes / mib, double(out_bytes) / std::max<std::size_t>(in_bytes, 1),
+      out_bytes / decode.median / 1e6, tokens / decode.median / 1e6, decode.median * 1e9 / std::max<std::size_t>(entries, 1), entries, spread, check_cost, extract.median * 1e3);
+  }
+
+  // Extraction into a scratch directory, which is emptied before every run
+  timing_t measure_extract(const std::filesystem::path& rom_path, const std::filesystem::path& out_dir, algorithm_t algorithm, std::endian byte_order, const bench_options_t& options) {
+    return measure(options.reps,
+      [&] { std::filesystem::remove_all(out_dir); },
+      [&] { extract_bolt(rom_path, out_dir, algorithm, byte_order, { .jobs = options.jobs }); });
+  }
+
+  // Tokens in everything decode_all decodes, counted on a decoder of its own so the timed ones stay uncounted
+  template<class fn_t>
+  std::uint64_t count_tokens(fn_t decode_all) {
+    decoder_t counter;
+    counter.enable_stats();
+    decode_all(counter);
+
+    std::uint64_t tokens = 0;
+    for (const codec_stats_t& s : counter.codec_stats()) {
+      for (std::uint64_t n : s.tokens) tokens += n;
+    }
+    return tokens;
+  }
+
+  // The stream has to hand out the same bytes and error as a full decode, whatever size the reads are
+  bool stream_matches(decoder_t& decoder, std::span<const std::byte> rom, std::size_t bolt_begin, const entry_t& entry, algorithm_t algorithm, std::endian byte_order) {
+    decoder.bind(rom, bolt_begin, algorithm, byte_order);
+    std::span<const std::byte> full = decoder.decode(entry);
+
+    for (std::size_t chunk_size : { 1, 7, 1000, 70000 }) {
+      // Data outside the rom can't be opened as a stream at all, the full decode has to fail as well
+      std::unique_ptr<entry_stream_t> stream;
+      try {
+        stream = open_entry_stream(rom, bolt_begin, entry, algorithm, byte_order, chunk_size);
+      }
+      catch (const std::runtime_error&) {
+        return bool(decoder.last_error());
+      }
+
+      std::vector<std::byte> chunk(chunk_size);
+      std::size_t pos = 0;
+      while (std::size_t n = stream->read(chunk)) {
+        if (n > full.size() - pos || !std::equal(chunk.begin(), chunk.begin() + n, full.begin() + pos)) return false;
+        pos += n;
+      }
+      if (pos != full.size() || stream->last_error().kind != decoder.last_error().kind) return false;
+    }
+    return true;
+  }
+
+  // bolt_archive_t has to load the same as a plain decode with decoder, the second time from its cache
+  bool load_matches(bolt_archive_t& loader, decoder_t& decoder, const entry_t& entry) {
+    std::span<const std::byte> full = decoder.decode(entry);
+    for (int pass = 0; pass < 2; ++pass) {
+      entry_ref_t loaded = loader.load(entry);
+      if (!std::ranges::equal(loaded.data(), full) || loaded.error().kind != decoder.last_error().kind) return false;
+    }
+    return true;
+  }
+
+  std::filesystem::path scratch_dir() {
+    return std::filesystem::temp_directory_path() / "bolt-bench";
+  }
+}
+
+bool BOLT::run_synthetic_benchmark(const bench_options_t& options) {
+  const algorithm_t algorithms[] = { algorithm_t::CDI, algorithm_t::DOS, algorithm_t::N64, algorithm_t::WIN, algorithm_t::XBOX };
+  const corpus_shape_t shapes[] = { corpus_shape_t::LITERAL, corpus_shape_t::MATCH, corpus_shape_t::RLE, corpus_shape_t::NESTED };
+
+  std::filesystem::path scratch = scratch_dir();
+  std::filesystem::create_directories(scratch);
+
+  bool all_correct = true;
+  print_header();
+  for (algorithm_t algorithm : algorithms) {
+    // Big endian tables on the platforms that have them, so both byte orders get exercised
+    std::endian byte_order = algorithm == algorithm_t::N64 || algorithm == algorithm_t::CDI ? std::endian::big : std::endian::little;
+
+    for (corpus_shape_t shape : shapes) {
+      std::uint64_t seed = 0xB017'0000ull + static_cast<unsigned>(algorithm) * 16 + static_cast<unsigned>(shape);
+      synthetic_archive_t archive = make_synthetic_archive(algorithm, byte_order, shape, options.corpus_size, seed);
+
+      decoder_t decoder{ archive.rom, 0, algorithm, byte_order };
+      auto entry = [&](const synthetic_file_t& file) -> const entry_t& {
+        return *reinterpret_cast<const entry_t*>(&archive.rom[file.entry_offset]);
+      };
+
+      // The generator knows what every entry should decode to, a benchmark of broken output is worthless
+      std::size_t wrong = 0;
+      for (const synthetic_file_t& file : archive.files) {
+        if (fnv1a_64(decoder.decode(entry(file))) != file.hash) wrong++;
+      }
+      if (wrong != 0) {
+        std::cerr << std::format("{} {}: {} of {} entries decoded wrong\n", algorithm_name(algorithm), shape_name(shape), wrong, archive.files.size());
+        all_correct = false;
+      }
+
+      std::size_t stream_wrong = 0;
+      for (const synthetic_file_t& file : archive.files) {
+        if (!stream_matches(decoder, archive.rom, 0, entry(file), algorithm, byte_order)) stream_wrong++;
+      }
+      if (stream_wrong != 0) {
+        std::cerr << std::format("{} {}: {} of {} entries streamed differently from a full decode\n", algorithm_name(algorithm), shape_name(shape), stream_wrong, archive.files.size());
+        all_correct = false;
+      }
+
+      std::uint64_t tokens = count_tokens([&](decoder_t& counter) {
+        counter.bind(archive.rom, 0, algorithm, byte_order);
+        for (const synthetic_file_t& file : archive.files) {
+          counter.decode(entry(file));
+        }
+      });
+
+      timing_t decode = measure(options.reps, [] {}, [&] {
+        for (const synthetic_file_t& file : archive.files) {
+          decoder.decode(entry(file));
+        }
+      });
+      timing_t unchecked = measure(options.reps, [] {}, [&] {
+        for (const synthetic_file_t& file : archive.files) {
+          decoder.decode_unchecked(entry(file));
+        }
+      });
+
+      std::filesystem::path rom_path = scratch / std::format("{}-{}.bin", algorithm_name(algorithm), shape_name(shape));
+      {
+        std::ofstream out(rom_path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(archive.rom.data()), archive.rom.size());
+      }
+      std::size_t load_wrong = 0;
+      {
+        bolt_archive_t loader{ rom_path, algorithm, byte_order };
+        auto check_folder = [&](auto& self, const folder_t& folder) -> void {
+          for (std::uint32_t i = 0; i < folder.size(); ++i) {
+            if (folder.is_folder(i)) {
+              self(self, loader.open_folder(folder, i));
+            }
+            else if (!load_matches(loader, decoder, folder[i])) {
+              load_wrong++;
+            }
+          }
+        };
+        decoder.bind(archive.rom, 0, algorithm, byte_order);
+        check_folder(check_folder, loader.root());
+      }
+      if (load_wrong != 0) {
+        std::cerr << std::format("{} {}: {} of {} entries loaded differently through bolt_archive_t\n", algorithm_name(algorithm), shape_name(shape), load_wrong, archive.files.size());
+        all_correct = false;
+      }
+
+      timing_t extract = measure_extract(rom_path, scratch / "out", algorithm, byte_order, options);
+      std::filesystem::remove(rom_path);
+
+      print_row(algorithm_name(algorithm), shape_name(shape), archive.rom.size(), archive.uncompressed_size, tokens, archive.files.size(), decode, unchecked, extract);
+    }
+  }
+
+  std::filesystem::remove_all(scratch);
+  return all_correct;
+}
+
+bool BOLT::run_rom_benchmark(const std::filesystem::path& input_file, algorithm_t algorithm, std::endian byte_order, const bench_options_t& options) {
+  std::filesystem::path scratch = scratch_dir();
+
+  bolt_reader_t reader{ algorithm, byte_order };
+  reader.read_from_file(input_file);
+
+  std::vector<bolt_reader_t::work_item_t> work;
+  reader.collect_work(scratch, work);
+
+  std::size_t total_size = 0;
+  for (const bolt_reader_t::work_item_t& item : work) {
+    total_size += item.entry->uncompressed_size(byte_order);
+  }
+
+  std::uint64_t tokens = count_tokens([&](decoder_t& counter) {
+    for (const bolt_reader_t::work_item_t& item : work) {
+      counter.bind(reader.data(), item.bolt_begin, algorithm, byte_order);
+      counter.decode(*item.entry);
+    }
+  });
+
+  decoder_t decoder;
+  decoder_t reference;
+  reference.set_quiet(true);
+  std::size_t stream_wrong = 0;
+  for (const bolt_reader_t::work_item_t& item : work) {
+    if (!stream_matches(reference, reader.data(), item.bolt_begin, *item.entry, algorithm, byte_order)) stream_wrong++;
+  }
+  if (stream_wrong != 0) {
+    std::cerr << std::format("{} of {} entries streamed differently from a full decode\n", stream_wrong, work.size());
+  }
+
+  std::vector<std::unique_ptr<bolt_archive_t>> loaders;
+  for (std::size_t i = 0; i < reader.archives().size(); ++i) {
+    loaders.push_back(std::make_unique<bolt_archive_t>(input_file, algorithm, byte_order, 64 * 1024 * 1024, i));
+  }
+  std::size_t load_wrong = 0;
+  for (const bolt_reader_t::work_item_t& item : work) {
+    std::size_t archive_index = std::find(reader.archives().begin(), reader.archives().end(), item.bolt_begin) - reader.archives().begin();
+    reference.bind(reader.data(), item.bolt_begin, algorithm, byte_order);
+    if (!load_matches(*loaders[archive_index], reference, *item.entry)) load_wrong++;
+  }
+  loaders.clear();
+  if (load_wrong != 0) {
+    std::cerr << std::format("{} of {} entries loaded differently through bolt_archive_t\n", load_wrong, work.size());
+  }
+
+  bool clean = true;
+  timing_t decode = measure(options.reps, [] {}, [&] {
+    for (const bolt_reader_t::work_item_t& item : work) {
+      decoder.bind(reader.data(), item.bolt_begin, algorithm, byte_order);
+      decoder.decode(*item.entry);
+      clean = clean && !decoder.last_error();
+    }
+  });
+
+  // Unchecked decoding is only safe once every entry went through the checked decoder without an error
+  timing_t unchecked{};
+  if (clean) {
+    unchecked = measure(options.reps, [] {}, [&] {
+      for (const bolt_reader_t::work_item_t& item : work) {
+        decoder.bind(reader.data(), item.bolt_begin, algorithm, byte_order);
+        decoder.decode_unchecked(*item.entry);
+      }
+    });
+  }
+
+  timing_t extract = measure_extract(input_file, scratch / "out", algorithm, byte_order, options);
+  std::filesystem::remove_all(scratch);
+
+  print_header();
+  print_row(algorithm_name(algorithm), "rom", reader.data().size(), total_size, tokens, work.size(), decode, unchecked, extract);
+  return stream_wrong == 0 && load_wrong == 0;
+}
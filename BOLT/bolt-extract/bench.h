@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <bit>
+
+#include "bolt.h"
+
+
+namespace BOLT {
+  struct bench_options_t {
+    std::size_t corpus_size = 16 * 1024 * 1024;  // uncompressed bytes per synthetic archive
+    unsigned reps = 5;                           // timed runs after one warm-up, the median is reported
+    unsigned jobs = 1;                           // for the end-to-end extraction
+  };
+
+  // Every algorithm against every corpus shape. Returns false if any entry decoded, streamed or loaded wrong.
+  bool run_synthetic_benchmark(const bench_options_t& options);
+
+  // Decode speed and extraction time for a real rom. Returns false if streaming any entry, or loading
+  // it through bolt_archive_t, gives different bytes or a different error than decoding it whole.
+  bool run_rom_benchmark(const std::filesystem::path& input_file, algorithm_t algorithm, std::endian byte_order, const bench_options_t& options);
+}
@@ -1,179 +1,603 @@
-#include <string>
-#include <filesystem>
-#include <fstream>
-#include <limits>
-#include <algorithm>
-#include <stdexcept>
-#include <cstddef>
-#include <iostream>
-#include <format>
-
-#include "bolt.h"
-#include "guess_type.h"
-#include "util.h"
-
-
-using namespace BOLT;
-
-namespace BOLT {
-  bool g_big_endian = false;
-}
-
-uint32_t entry_t::uncompressed_size() const {
-  return bswap_if(uncompressed_size_be);
-}
-
-uint32_t entry_t::data_offset() const {
-  return bswap_if(data_offset_be);
-}
-
-uint32_t entry_t::file_hash() const {
-  return bswap_if(file_hash_be);
-}
-
-void bolt_reader_t::read_from_file(const std::filesystem::path& filename) {
-  std::ifstream rom_file(filename, std::ios::binary | std::ios::ate);
-  std::streamsize rom_size = rom_file.tellg();
-  rom_file.seekg(0);
-
-  rom.resize(rom_size);
-  rom_file.read(reinterpret_cast<char*>(rom.data()), rom_size);
-
-  find_bolt_archive();
-}
-
-constexpr std::byte BOLT_STR[] = { std::byte('B'), std::byte('O'), std::byte('L'), std::byte('T') };
-constexpr std::byte BOLT_STR_LOWER[] = { std::byte('b'), std::byte('o'), std::byte('l'), std::byte('t') };
-
-void bolt_reader_t::find_bolt_archive() {
-  auto found = std::ranges::search(rom, BOLT_STR);
-  if (!found) {
-    found = std::ranges::search(rom, BOLT_STR_LOWER);
-    if (!found) {
-      throw std::runtime_error("Failed to find BOLT header. Rom is either incorrect format, corrupted, or does not contain BOLT archive.");
-    }
-  }
-
-  this->bolt_begin = cursor_pos = std::distance(rom.begin(), found.begin());
-  this->archive = reinterpret_cast<archive_t*>(&rom[bolt_begin]);
-}
-
-void bolt_reader_t::set_cur_pos(std::size_t pos) {
-  cursor_pos = bolt_begin + pos;
-}
-
-std::byte bolt_reader_t::read_u8() {
-  std::byte v = rom[cursor_pos];
-  cursor_pos++;
-  return v;
-}
-
-unsigned bolt_reader_t::get_num_entries() {
-  if (algorithm == algorithm_t::XBOX) {
-    return bswap_if(reinterpret_cast<const archive_t_xbox*>(this->archive)->num_entries);
-  }
-
-  unsigned num_entries = this->archive->num_entries;
-  if (num_entries == 0) num_entries = 256;
-}
-
-void bolt_reader_t::extract_all_to(const std::filesystem::path& out_dir) {
-  unsigned num_entries = this->get_num_entries();
-  if (num_entries == 0) num_entries = 256;
-
-  for (unsigned i = 0; i < num_entries; ++i) {
-    extract_entry(out_dir, archive->entries[i], i);
-  }
-}
-
-void bolt_reader_t::extract_dir(const std::filesystem::path& out_dir, const entry_t* entries, std::uint32_t num_entries) {
-  for (std::uint32_t i = 0; i < num_entries; ++i) {
-    extract_entry(out_dir, entries[i], i);
-  }
-}
-
-void bolt_reader_t::extract_entry(const std::filesystem::path& out_dir, const entry_t& entry, unsigned index) {
-  std::uint32_t hash = entry.file_hash();
-  std::uint32_t offset = entry.data_offset();
-
-  if (hash == 0) {  // is directory
-    std::uint32_t num_items = entry.file_type;
-    if (this->algorithm == algorithm_t::XBOX) {
-      num_items <<= 8;
-      num_items |= entry.unk_2;
-    }
-    if (num_items == 0) num_items = 256;
-
-    extract_dir(out_dir / std::format("{:03X}", index), entry_at(offset), num_items);
-  }
-  else { // is file
-    extract_file(out_dir, entry, index);
-  }
-}
-
-void bolt_reader_t::err_msg(const std::string& msg, std::uint8_t value) {
-  std::cerr << msg << "; value " << std::uint32_t(value) << " at offset " << std::hex << cursor_pos << " (BOLT+" << (cursor_pos - bolt_begin) << "); Filetype: " << std::uint32_t(current_filetype) << "\n";
-}
-
-void bolt_reader_t::extract_file(const std::filesystem::path& out_dir, const entry_t& entry, unsigned index) {
-  std::uint32_t expected_size = entry.uncompressed_size();
-  std::uint32_t offset = entry.data_offset();
-
-  std::vector<std::byte> result;
-  result.reserve(expected_size);
-
-  this->current_filetype = entry.file_type;
-
-  if (entry.flags & FLAG_UNCOMPRESSED) {
-    set_cur_pos(offset);
-    result.insert(result.end(), &rom[cursor_pos], &rom[cursor_pos] + expected_size);
-  }
-  else {
-    switch (algorithm) {
-    case algorithm_t::CDI:
-      decompress_cdi(offset, expected_size, result);
-      break;
-    case algorithm_t::DOS:
-      decompress_dos(offset, expected_size, result);
-      break;
-    case algorithm_t::N64:
-    case algorithm_t::XBOX:
-      decompress_n64(offset, expected_size, result);
-      break;
-    case algorithm_t::WIN:
-      decompress_win(offset, expected_size, result);
-      break;
-    }
-  }
-
-  write_result(out_dir, index, result, expected_size);
-}
-
-void bolt_reader_t::write_result(const std::filesystem::path& base_dir, unsigned index, const std::vector<std::byte>& data, std::uint32_t filesize) {
-  std::filesystem::path filename = base_dir / std::format("{:03X}{}", index, guess_extension(data));
-
-  if (data.size() != filesize) {
-    std::cerr << "Result size is wrong. " << std::dec << data.size() << " != " << filesize << " for file " << filename.filename() << "\n";
-  }
-
-  std::filesystem::create_directories(base_dir);
-  std::ofstream ofile(filename, std::ios::binary);
-  ofile.write(reinterpret_cast<const char*>(data.data()), data.size());
-}
-
-const entry_t* bolt_reader_t::entry_at(std::uint32_t offset) const {
-  return reinterpret_cast<const entry_t*>(&rom[bolt_begin + offset]);
-}
-
-bool BOLT::extract_bolt(const std::filesystem::path& input_file, const std::filesystem::path& output_dir, algorithm_t algorithm) {
-  std::filesystem::create_directories(output_dir);
-
-  bolt_reader_t reader{ algorithm };
-  reader.read_from_file(input_file);
-  reader.extract_all_to(output_dir);
-  return true;
-}
-
-bolt_reader_t::bolt_reader_t(algorithm_t algo)
-  : algorithm(algo) {}
-
+#include <string>
+#include <filesystem>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <format>
+#include <memory>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstring>
+
+#include "bolt.h"
+#include "decoder.h"
+#include "guess_type.h"
+#include "util.h"
+#include "thread_pool.h"
+#include "scan.h"
+#include "output_writer.h"
+#include "manifest.h"
+#include "incremental.h"
+#include "stats.h"
+
+
+using namespace BOLT;
+
+const char* BOLT::algorithm_name(algorithm_t algorithm) {
+  switch (algorithm) {
+  case algorithm_t::CDI: return "cdi";
+  case algorithm_t::DOS: return "dos";
+  case algorithm_t::N64: return "n64";
+  case algorithm_t::WIN: return "win";
+  case algorithm_t::XBOX: return "xbox";
+  default: return "?";
+  }
+}
+
+uint32_t entry_t::uncompressed_size(std::endian order) const {
+  return bswap_if(uncompressed_size_be, order);
+}
+
+uint32_t entry_t::data_offset(std::endian order) const {
+  return bswap_if(data_offset_be, order);
+}
+
+uint32_t entry_t::file_hash(std::endian order) const {
+  return bswap_if(file_hash_be, order);
+}
+
+void bolt_reader_t::read_from_file(const std::filesystem::path& filename) {
+  rom_file.open(filename);
+  rom = rom_file.data();
+
+  // The header search is a linear scan, decoding afterwards jumps around by data_offset
+  rom_file.advise(0, rom.size(), access_hint_t::SEQUENTIAL);
+  find_bolt_archives();
+  rom_file.advise(0, rom.size(), access_hint_t::NORMAL);
+
+  for (std::size_t begin : archive_offsets) {
+    const archive_t* header = reinterpret_cast<const archive_t*>(&rom[begin]);
+    rom_file.advise(begin, offsetof(archive_t, entries) + get_num_entries(header) * sizeof(entry_t), access_hint_t::WILLNEED);
+  }
+}
+
+bool bolt_reader_t::read_from_memory(std::span<const std::byte> data, const std::vector<std::size_t>& magics) {
+  rom = data;
+  archive_offsets.clear();
+  validate_archives(magics);
+  return !archive_offsets.empty();
+}
+
+void bolt_reader_t::find_bolt_archives() {
+  std::vector<std::size_t> candidates = find_bolt_magics(rom);
+  if (candidates.empty()) {
+    throw std::runtime_error("Failed to find BOLT header. Rom is either incorrect format, corrupted, or does not contain BOLT archive.");
+  }
+
+  validate_archives(candidates);
+  if (archive_offsets.empty()) {
+    fall_back_to_first(candidates);
+  }
+}
+
+void bolt_reader_t::fall_back_to_first(const std::vector<std::size_t>& candidates) {
+  auto first = std::find_if(candidates.begin(), candidates.end(), [&](std::size_t begin) { return rom.size() - begin >= offsetof(archive_t, entries); });
+  if (first == candidates.end()) {
+    throw std::runtime_error("Failed to find BOLT header. Rom is either incorrect format, corrupted, or does not contain BOLT archive.");
+  }
+  std::cerr << "No BOLT header passed validation, trying the first one found.\n";
+  archive_offsets.push_back(*first);
+}
+
+void bolt_reader_t::read_one_archive(const std::filesystem::path& filename, std::optional<std::size_t> archive_begin) {
+  rom_file.open(filename);
+  rom = rom_file.data();
+  archive_offsets.clear();
+
+  if (archive_begin) {
+    if (*archive_begin < rom.size()) validate_archives({ *archive_begin });
+    if (archive_offsets.empty()) {
+      throw std::runtime_error(std::format("No valid BOLT header at offset {:08X}", *archive_begin));
+    }
+    return;
+  }
+
+  // Scanned a chunk at a time, the rest of the rom is never paged in once a header passes.
+  // Chunks overlap by 3 bytes so a magic across the boundary is still found, and only once.
+  constexpr std::size_t SCAN_CHUNK = 1024 * 1024;
+  std::vector<std::size_t> candidates;
+  for (std::size_t pos = 0; pos < rom.size() && archive_offsets.empty(); pos += SCAN_CHUNK) {
+    std::vector<std::size_t> found = find_bolt_magics(rom.subspan(pos, std::min(SCAN_CHUNK + 3, rom.size() - pos)));
+    for (std::size_t& begin : found) begin += pos;
+
+    validate_archives(found);
+    candidates.insert(candidates.end(), found.begin(), found.end());
+  }
+
+  if (archive_offsets.empty()) {
+    fall_back_to_first(candidates);
+  }
+  archive_offsets.resize(1);
+}
+
+void bolt_reader_t::validate_archives(const std::vector<std::size_t>& candidates) {
+  std::size_t covered_until = 0;
+  for (std::size_t begin : candidates) {
+    if (begin < covered_until) continue;  // magic inside the data of an archive we already have
+    bool valid = with_byte_order(byte_order, [&](auto order) { return is_valid_archive<decltype(order)::value>(begin); });
+    if (!valid) continue;
+
+    archive_offsets.push_back(begin);
+
+    const archive_t* header = reinterpret_cast<const archive_t*>(&rom[begin]);
+    covered_until = begin + bswap_if(header->end_offset, byte_order);
+  }
+}
+
+// Cheap sanity checks on the header and top level entries, enough to weed out a stray "BOLT" in other data
+template<std::endian order>
+bool bolt_reader_t::is_valid_archive(std::size_t begin) const {
+  std::size_t available = rom.size() - begin;
+  if (available < sizeof(archive_t)) return false;
+
+  const archive_t* header = reinterpret_cast<const archive_t*>(&rom[begin]);
+  unsigned num_entries = declared_entries_of<order>(header);
+
+  std::size_t table_end = offsetof(archive_t, entries) + num_entries * sizeof(entry_t);
+  if (table_end > available) return false;
+  if (from_endian<order>(header->end_offset) > available) return false;
+
+  // Zero filled padding after a stray magic would otherwise read as a table of folders all at offset 0
+  const entry_t zero_entry{};
+  bool all_zero = true;
+  for (unsigned i = 0; i < num_entries; ++i) {
+    const entry_t& entry = header->entries[i];
+    all_zero = all_zero && std::memcmp(&entry, &zero_entry, sizeof(entry_t)) == 0;
+    std::size_t offset = entry.data_offset<order>();
+    if (offset > available) return false;  // an empty last entry points right at the end
+
+    if (entry.file_hash<order>() == 0) {
+      if (offset < table_end) return false;  // a folder table can't overlap the header or the top level table
+      if (offset + get_dir_size(entry) * sizeof(entry_t) > available) return false;
+    }
+    else if (entry.flags & FLAG_UNCOMPRESSED) {
+      if (offset + entry.uncompressed_size<order>() > available) return false;
+    }
+  }
+  return !all_zero;
+}
+
+void bolt_reader_t::select_archive(std::size_t begin) {
+  this->bolt_begin = begin;
+  this->archive = reinterpret_cast<const archive_t*>(&rom[bolt_begin]);
+}
+
+template<std::endian order>
+unsigned bolt_reader_t::declared_entries_of(const archive_t* header) const {
+  unsigned num_entries = header->num_entries;
+  if (algorithm == algorithm_t::XBOX) {
+    num_entries = from_endian<order>(reinterpret_cast<const archive_t_xbox*>(header)->num_entries);
+  }
+
+  if (num_entries == 0) num_entries = 256;
+  return num_entries;
+}
+
+// Only the archive tried after nothing passed validation can claim more entries than the rom holds
+template<std::endian order>
+unsigned bolt_reader_t::num_entries_of(const archive_t* header) const {
+  std::size_t table = reinterpret_cast<const std::byte*>(header->entries) - rom.data();
+  std::size_t room = (rom.size() - table) / sizeof(entry_t);
+  return unsigned(std::min<std::size_t>(declared_entries_of<order>(header), room));
+}
+
+unsigned bolt_reader_t::get_num_entries(const archive_t* header) const {
+  return with_byte_order(byte_order, [&](auto order) { return num_entries_of<decltype(order)::value>(header); });
+}
+
+std::uint32_t bolt_reader_t::get_dir_size(const entry_t& entry) const {
+  std::uint32_t num_items = entry.file_type;
+  if (this->algorithm == algorithm_t::XBOX) {
+    num_items <<= 8;
+    num_items |= entry.unk_2;
+  }
+  if (num_items == 0) num_items = 256;
+  return num_items;
+}
+
+void bolt_reader_t::collect_work(const std::filesystem::path& out_dir, std::vector<work_item_t>& work) {
+  for (std::size_t begin : archive_offsets) {
+    // Only split the output up when there is more than one archive, so the usual case looks the same as always
+    std::filesystem::path archive_dir = out_dir;
+    if (archive_offsets.size() > 1) {
+      archive_dir /= std::format("{:08X}", begin);
+    }
+
+    // dirs[i] is the folder of the entries i levels down
+    std::vector<std::filesystem::path> dirs{ archive_dir };
+    walk_archive(begin, [&](const entry_t& entry, std::span<const unsigned> indices) {
+      std::size_t depth = indices.size() - 1;
+      if (entry.file_hash_be != 0) {
+        work.push_back({ dirs[depth], &entry, begin, indices.back() });
+        return walk_step_t::NEXT;
+      }
+      dirs.resize(depth + 1);
+      dirs.push_back(dirs[depth] / std::format("{:03X}", indices.back()));
+      return walk_step_t::DESCEND;
+    });
+  }
+}
+
+void bolt_reader_t::walk_archive(std::size_t begin, const walk_visit_t& visit, const walk_skip_t& skip) const {
+  with_byte_order(byte_order, [&](auto order) { walk_archive_as<decltype(order)::value>(begin, visit, skip); });
+}
+
+template<std::endian order>
+void bolt_reader_t::walk_archive_as(std::size_t begin, const walk_visit_t& visit, const walk_skip_t& skip) const {
+  struct table_t {
+    std::size_t offset;
+    const entry_t* entries;
+    std::uint32_t size;
+  };
+
+  // Folders may share a table, each of them is walked. Tables that nest inside themselves are not,
+  // and the cap keeps a crafted rom of shared tables from multiplying out without end.
+  constexpr std::size_t MAX_WALKED_ENTRIES = 1024 * 1024;
+
+  // Kept on the heap rather than recursing, a crafted rom can nest folders as deep as it likes
+  const archive_t* header = reinterpret_cast<const archive_t*>(&rom[begin]);
+  std::size_t root = begin + offsetof(archive_t, entries);
+  std::vector<table_t> tables{ { root, header->entries, num_entries_of<order>(header) } };
+  std::vector<unsigned> indices{ 0 };
+  std::unordered_set<std::size_t> open_tables{ root };  // the ones in tables
+  std::size_t walked = tables.back().size;
+
+  while (!tables.empty()) {
+    if (indices.back() == tables.back().size) {
+      open_tables.erase(tables.back().offset);
+      tables.pop_back();
+      indices.pop_back();
+      if (!indices.empty()) indices.back()++;
+      continue;
+    }
+
+    const entry_t& entry = tables.back().entries[indices.back()];
+    walk_step_t step = visit(entry, indices);
+    if (step == walk_step_t::STOP) return;
+    if (step != walk_step_t::DESCEND || entry.file_hash<order>() != 0) {
+      indices.back()++;
+      continue;
+    }
+
+    std::size_t table = begin + entry.data_offset<order>();
+    std::uint32_t size = get_dir_size(entry);
+    const char* problem = nullptr;
+    if (table > rom.size() || (rom.size() - table) / sizeof(entry_t) < size) {
+      problem = "lies outside the rom";
+    }
+    else if (open_tables.contains(table)) {
+      problem = "loops back into a folder it is inside";
+    }
+    else if (walked + size > MAX_WALKED_ENTRIES) {
+      problem = "takes the archive past a million entries";
+    }
+
+    if (problem) {
+      if (skip) {
+        skip(indices, problem);
+      }
+      else {
+        std::ostringstream ss;
+        ss << "Folder ";
+        if (archive_offsets.size() > 1) ss << std::format("{:08X}/", begin);
+        for (std::size_t i = 0; i < indices.size(); ++i) ss << std::format("{}{:03X}", i == 0 ? "" : "/", indices[i]);
+        ss << " " << problem << ", skipping its contents\n";
+        std::cerr << ss.str();
+      }
+      indices.back()++;
+      continue;
+    }
+
+    tables.push_back({ table, reinterpret_cast<const entry_t*>(&rom[table]), size });
+    indices.push_back(0);
+    open_tables.insert(table);
+    walked += size;
+  }
+}
+
+const entry_t& bolt_reader_t::find_entry(std::span<const unsigned> indices) {
+  select_archive(archive_offsets.front());
+
+  auto path_to = [&](std::size_t depth) {
+    std::string path;
+    for (std::size_t i = 0; i < depth; ++i) path += std::format("{}{:03X}", i == 0 ? "" : "/", indices[i]);
+    return path;
+  };
+
+  // Only the folders along the path are descended into, matched is how much of it was found so far
+  const entry_t* found = nullptr;
+  std::size_t matched = 0;
+  unsigned seen = 0;
+  walk_archive(bolt_begin, [&](const entry_t& entry, std::span<const unsigned> at) {
+    std::size_t depth = at.size() - 1;
+    if (at[depth] < indices[depth]) {
+      seen = at[depth] + 1;
+      return walk_step_t::NEXT;
+    }
+    if (at[depth] > indices[depth]) return walk_step_t::STOP;
+
+    if (depth + 1 == indices.size()) {
+      if (entry.file_hash_be == 0) throw std::runtime_error(path_to(depth + 1) + " is a folder");
+      found = &entry;
+      return walk_step_t::STOP;
+    }
+    if (entry.file_hash_be != 0) throw std::runtime_error(path_to(depth + 1) + " is a file, not a folder");
+
+    matched = depth + 1;
+    seen = 0;
+    return walk_step_t::DESCEND;
+  }, [&](std::span<const unsigned> at, const std::string& problem) {
+    throw std::runtime_error("Folder " + path_to(at.size()) + " " + problem);
+  });
+
+  if (!found) {
+    throw std::runtime_error(std::format("{} only has {} entries", matched == 0 ? "The archive" : path_to(matched), seen));
+  }
+  return *found;
+}
+
+void bolt_reader_t::extract_file(decoder_t& decoder, output_writer_t& writer, std::span<const file_output_t> outputs) {
+  const work_item_t& first = *outputs[0].item;
+  decoder.bind(rom, first.bolt_begin, algorithm, byte_order);
+  auto start = std::chrono::steady_clock::now();
+  std::span<const std::byte> result = decoder.decode(*first.entry);
+  auto decode_time = std::chrono::steady_clock::now() - start;
+
+  // Stored entries come back as a view of the mapped rom and are sniffed and written from there.
+  // The mapping stays until the writer is done with them.
+  bool in_rom = first.entry->flags & FLAG_UNCOMPRESSED;
+  file_type_t type = guess_type(result, byte_order);
+  for (const file_output_t& output : outputs) {
+    const work_item_t& item = *output.item;
+    std::filesystem::path filename = item.out_dir / std::format("{:03X}{}", item.index, type_extension(type));
+
+    if (output.record) {
+      *output.record = manifest_entry_t{ filename, item.bolt_begin, *item.entry, byte_order };
+      output.record->guessed_type = type;
+      output.record->compressed_size = decoder.last_input_size();
+      output.record->decoded_size = result.size();
+      output.record->error = decoder.last_error();
+      if (&output == &outputs[0]) {
+        output.record->decode_time = std::chrono::duration_cast<std::chrono::nanoseconds>(decode_time);
+      }
+    }
+    write_result(writer, std::move(filename), result, item.entry->uncompressed_size(byte_order), decoder.is_quiet(), in_rom);
+  }
+}
+
+void bolt_reader_t::write_result(output_writer_t& writer, std::filesystem::path filename, std::span<const std::byte> data, std::uint32_t filesize, bool quiet, bool in_rom) {
+  if (data.size() != filesize && !quiet) {
+    std::ostringstream ss;
+    ss << "Result size is wrong. " << data.size() << " != " << filesize << " for file " << filename.filename() << "\n";
+    std::cerr << ss.str();
+  }
+
+  if (in_rom) {
+    writer.write_borrowed(std::move(filename), data);
+  }
+  else {
+    writer.write(std::move(filename), data);
+  }
+}
+
+const entry_t* bolt_reader_t::entry_at(std::uint32_t offset) const {
+  return reinterpret_cast<const entry_t*>(&rom[bolt_begin + offset]);
+}
+
+namespace {
+  // Where an entry sits in the archive, like 01A/003. Unlike the filename it doesn't depend on what the entry decodes to.
+  std::string entry_key(const bolt_reader_t::work_item_t& item, const std::filesystem::path& output_dir) {
+    return (item.out_dir / std::format("{:03X}", item.index)).lexically_relative(output_dir).generic_string();
+  }
+}
+
+bool BOLT::extract_batch(const std::vector<batch_input_t>& inputs, extract_options_t options) {
+  struct rom_t {
+    std::unique_ptr<bolt_reader_t> reader;
+    std::vector<bolt_reader_t::work_item_t> items;
+    std::filesystem::path output_dir;
+    extract_state_t state;  // what the last --incremental run wrote
+  };
+
+  // One payload, with every file that points at it
+  struct batch_item_t {
+    bolt_reader_t* reader;
+    std::vector<bolt_reader_t::file_output_t> outputs;
+    std::uint32_t size;
+    std::size_t input_offset;  // of the payload in the rom
+  };
+
+  // Declared before the writer, stored entries are written straight from the mapped roms
+  std::vector<rom_t> roms;
+
+  // Shared by every worker, so writes keep overlapping with decoding even when running serially
+  output_writer_t writer{ options.sink ? std::move(options.sink) : std::make_unique<directory_sink_t>(), options.dedupe };
+
+  bool all_read = true;
+  std::size_t num_files = 0;
+
+  for (const batch_input_t& input : inputs) {
+    rom_t rom{ std::make_unique<bolt_reader_t>(input.algorithm, input.byte_order), {}, input.output_dir };
+    try {
+      rom.reader->read_from_file(input.input_file);
+      rom.reader->collect_work(input.output_dir, rom.items);
+    }
+    catch (const std::exception& e) {
+      std::cerr << input.input_file.string() << ": " << e.what() << "\n";
+      all_read = false;
+      continue;
+    }
+
+    if (options.incremental) {
+      rom.state.load(input.output_dir);
+    }
+    writer.add_directory(input.output_dir);
+    num_files += rom.items.size();
+    roms.push_back(std::move(rom));
+  }
+
+  // One row per file in archive order, whatever order the work runs in. The incremental state and
+  // the statistics are built from them too.
+  bool keep_rows = options.manifest || options.incremental || options.stats;
+  std::vector<manifest_entry_t> rows;
+  if (keep_rows) rows.resize(num_files);
+  std::vector<bool> skipped(num_files);
+
+  // Entries sharing data_offset, flags and size decode to the same bytes, so each payload is only decoded once
+  std::vector<batch_item_t> work;
+  std::size_t slot = 0;
+  for (rom_t& rom : roms) {
+    std::size_t first_payload = work.size();
+    std::map<std::tuple<std::size_t, std::uint8_t, std::uint32_t>, std::size_t> payloads;
+    std::endian order = rom.reader->get_byte_order();
+    extract_state_t previous = std::move(rom.state);
+    std::unordered_map<std::string, file_stamp_t> on_disk;
+    if (options.incremental) {
+      on_disk = stamp_output_files(rom.output_dir);
+    }
+
+    for (const bolt_reader_t::work_item_t& item : rom.items) {
+      manifest_entry_t* record = keep_rows ? &rows[slot] : nullptr;
+
+      if (options.incremental) {
+        std::string key = entry_key(item, rom.output_dir);
+        const extracted_file_t* last = previous.find(key);
+        auto stamp = last ? on_disk.find(last->filename) : on_disk.end();
+        if (stamp != on_disk.end() && stamp->second == last->stamp && fingerprint_entry(rom.reader->data(), item.bolt_begin, *item.entry, order, last->fingerprint.input_size) == last->fingerprint) {
+          *record = manifest_entry_t{ rom.output_dir / last->filename, item.bolt_begin, *item.entry, order };
+          record->guessed_type = last->type;
+          record->compressed_size = last->fingerprint.input_size;
+          record->decoded_size = last->stamp.size;
+          rom.state.set(key, *last);
+          skipped[slot++] = true;
+          continue;
+        }
+      }
+      slot++;
+
+      std::uint32_t size = item.entry->uncompressed_size(order);
+      std::size_t input_offset = item.bolt_begin + item.entry->data_offset(order);
+      auto [payload, inserted] = payloads.try_emplace({ input_offset, item.entry->flags, size }, work.size());
+      if (inserted) {
+        work.push_back({ rom.reader.get(), {}, size, input_offset });
+      }
+      work[payload->second].outputs.push_back({ &item, record });
+    }
+
+    // Walking the tables jumps around the rom, decoding in data order reads it front to back
+    std::stable_sort(work.begin() + first_payload, work.end(), [](const batch_item_t& a, const batch_item_t& b) { return a.input_offset < b.input_offset; });
+  }
+
+  if (options.jobs == 1) {
+    decoder_t decoder;
+    decoder.set_quiet(options.quiet);
+    if (options.stats) decoder.enable_stats();
+
+    // The data of the entries coming up, at most about their decoded size, is read in the background
+    // while this one decodes. Asked for a window at a time, so small entries don't cost a call each.
+    constexpr std::size_t READAHEAD_WINDOW = 1024 * 1024;
+    const bolt_reader_t* ahead_reader = nullptr;
+    std::size_t ahead_until = 0;
+    for (std::size_t i = 0; i < work.size(); ++i) {
+      if (i + 1 < work.size()) {
+        const batch_item_t& next = work[i + 1];
+        std::size_t next_end = next.input_offset + next.size;
+        if (next.reader != ahead_reader || next_end > ahead_until) {
+          ahead_reader = next.reader;
+          ahead_until = std::max(next_end, next.input_offset + READAHEAD_WINDOW);
+          next.reader->prefetch(next.input_offset, ahead_until - next.input_offset);
+        }
+      }
+      work[i].reader->extract_file(decoder, writer, work[i].outputs);
+    }
+    if (options.stats) options.stats->add_codecs(decoder.codec_stats());
+  }
+  else {
+    // Largest first across every rom, so a single huge entry doesn't end up as the tail
+    std::stable_sort(work.begin(), work.end(), [](const batch_item_t& a, const batch_item_t& b) { return a.size > b.size; });
+
+    thread_pool_t pool{ options.jobs };
+    std::vector<decoder_t> decoders(pool.size());
+    for (decoder_t& decoder : decoders) {
+      decoder.set_quiet(options.quiet);
+      if (options.stats) decoder.enable_stats();
+    }
+
+    std::vector<thread_pool_t::task_t> tasks;
+    tasks.reserve(work.size());
+    for (const batch_item_t& w : work) {
+      tasks.push_back([&decoders, &writer, &w](unsigned worker) {
+        w.reader->extract_file(decoders[worker], writer, w.outputs);
+      });
+    }
+    pool.submit(std::move(tasks));
+    pool.wait();
+
+    if (options.stats) {
+      for (const decoder_t& decoder : decoders) options.stats->add_codecs(decoder.codec_stats());
+    }
+  }
+
+  bool ok = writer.close() && all_read;
+
+  // Entries that failed to decode are left out, so the next run tries them again
+  if (options.incremental) {
+    slot = 0;
+    for (rom_t& rom : roms) {
+      for (const bolt_reader_t::work_item_t& item : rom.items) {
+        const manifest_entry_t& row = rows[slot];
+        if (skipped[slot++] || row.error) continue;
+
+        auto fingerprint = fingerprint_entry(rom.reader->data(), item.bolt_begin, *item.entry, rom.reader->get_byte_order(), row.compressed_size);
+        if (!fingerprint) continue;
+
+        if (auto stamp = stamp_file(row.path)) {
+          rom.state.set(entry_key(item, rom.output_dir), { *fingerprint, row.path.lexically_relative(rom.output_dir).generic_string(), row.guessed_type, *stamp });
+        }
+      }
+
+      if (!rom.state.save(rom.output_dir)) {
+        std::cerr << "Can't save " << (rom.output_dir / extract_state_t::FILE_NAME).string() << "\n";
+        ok = false;
+      }
+    }
+  }
+
+  if (options.stats) {
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+      if (!skipped[i]) options.stats->entries.push_back(rows[i]);
+    }
+  }
+  if (options.manifest) {
+    options.manifest->insert(options.manifest->end(), std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+  }
+  if (options.dedupe != dedupe_mode_t::NONE) {
+    std::cerr << std::format("{} of {} files duplicate another one, {} bytes\n", writer.duplicate_files(), num_files, writer.duplicate_size());
+  }
+  return ok;
+}
+
+bool BOLT::extract_bolt(const std::filesystem::path& input_file, const std::filesystem::path& output_dir, algorithm_t algorithm, std::endian byte_order, extract_options_t options) {
+  return extract_batch({ { input_file, output_dir, algorithm, byte_order } }, std::move(options));
+}
+
+bolt_reader_t::bolt_reader_t(algorithm_t algo, std::endian byte_order)
+  : algorithm(algo), byte_order(byte_order) {}
+
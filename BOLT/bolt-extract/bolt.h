@@ -1,109 +1,208 @@
-#pragma once
-#include <cstdint>
-#include <vector>
-#include <string>
-#include <filesystem>
-
-
-namespace BOLT {
-  enum class algorithm_t {
-    UNKNOWN,
-    CDI,
-    DOS,
-    N64,
-    WIN,
-    XBOX,
-  };
-
-  bool extract_bolt(const std::filesystem::path& input_file, const std::filesystem::path& output_dir, algorithm_t algorithm);
-
-  enum flags_t {
-    FLAG_UNCOMPRESSED = 0x08
-  };
-
-  struct entry_t {
-    std::uint8_t flags;
-    std::uint8_t unk_1;
-
-    // If this is specified, calls an indexed special function which doesn't exist anywhere I've seen
-    std::uint8_t unk_2;
-    std::uint8_t file_type;
-    std::uint32_t uncompressed_size_be;
-    std::uint32_t data_offset_be;
-
-    // cleared and used as the uncompressed file pointer in official implementations
-    std::uint32_t file_hash_be;
-
-    uint32_t uncompressed_size() const;
-    uint32_t data_offset() const;
-    uint32_t file_hash() const;
-  };
-
-  struct archive_t {
-    uint32_t magic; // 'B', 'O', 'L', 'T'
-    uint8_t hour;
-    uint8_t minute;
-    uint8_t second;
-    uint8_t millisecond;
-    uint8_t month;
-    uint8_t day;
-    uint8_t year;   // Since 1900
-    uint8_t num_entries;
-    uint32_t end_offset;  // most of the time
-    entry_t entries[1];
-  };
-
-  struct archive_t_xbox {
-    uint32_t magic; // 'B', 'O', 'L', 'T'
-    uint8_t hour;
-    uint8_t minute;
-    uint8_t second;
-    uint8_t month;
-    uint8_t day;
-    uint8_t year;   // Since 1900
-    uint16_t num_entries;
-    uint32_t end_offset;  // most of the time
-    entry_t entries[1];
-  };
-
-  class bolt_reader_t {
-  private:
-    std::vector<std::byte> rom;
-
-    algorithm_t algorithm;
-
-    std::size_t bolt_begin = 0;
-    std::size_t cursor_pos = 0;
-
-    std::uint8_t current_filetype = 255;
-
-    const archive_t* archive;
-
-    const entry_t* entry_at(std::uint32_t offset) const;
-
-    std::byte read_u8();
-    void err_msg(const std::string& msg, std::uint8_t opcode);
-
-    void extract_dir(const std::filesystem::path& out_dir, const entry_t *entries, uint32_t num_entries);
-    void extract_file(const std::filesystem::path& out_dir, const entry_t& entry, unsigned index);
-    void extract_entry(const std::filesystem::path& out_dir, const entry_t& entry, unsigned index);
-
-    void set_cur_pos(std::size_t pos);
-
-    void find_bolt_archive();
-    void write_result(const std::filesystem::path& base_dir, unsigned index, const std::vector<std::byte> &data, std::uint32_t filesize);
-    void decompress_cdi(std::uint32_t offset, std::uint32_t expected_size, std::vector<std::byte>& result);
-    void decompress_dos(std::uint32_t offset, std::uint32_t expected_size, std::vector<std::byte>& result);
-    void decompress_n64(std::uint32_t offset, std::uint32_t expected_size, std::vector<std::byte>& result);
-    void decompress_win(std::uint32_t offset, std::uint32_t expected_size, std::vector<std::byte>& result);
-    void decompress_win_special_9(std::uint32_t offset, std::uint32_t expected_size, std::vector<std::byte>& result);
-    void decompress_dos_special_8(std::uint32_t offset, std::uint32_t expected_size, std::vector<std::byte>& result);
-
-    unsigned get_num_entries();
-  public:
-    void read_from_file(const std::filesystem::path& filename);
-    void extract_all_to(const std::filesystem::path& out_dir);
-
-    bolt_reader_t(algorithm_t algo);
-  };
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <bit>
+
+#include "mapped_file.h"
+#include "output_writer.h"
+#include "util.h"
+
+
+namespace BOLT {
+  enum class algorithm_t {
+    UNKNOWN,
+    CDI,
+    DOS,
+    N64,
+    WIN,
+    XBOX,
+  };
+
+  const char* algorithm_name(algorithm_t algorithm);
+
+  struct manifest_entry_t;
+  struct decode_stats_t;
+
+  struct batch_input_t {
+    std::filesystem::path input_file;
+    std::filesystem::path output_dir;
+    algorithm_t algorithm;
+    std::endian byte_order;
+  };
+
+  struct extract_options_t {
+    unsigned jobs = 1;                                  // entries decoded in parallel, 0 for one per core
+    std::unique_ptr<output_sink_t> sink;                // loose files under each output_dir without one
+    std::vector<manifest_entry_t>* manifest = nullptr;  // gets one row per extracted file, in archive order
+    dedupe_mode_t dedupe = dedupe_mode_t::NONE;
+    bool incremental = false;                           // skip entries unchanged since the last run, loose files only
+    decode_stats_t* stats = nullptr;                    // token counts and per-file numbers of everything decoded
+    bool quiet = false;                                 // decode errors only go to the rows, not to stderr
+  };
+
+  // Extracts every input on one shared pool, jobs works like for a single rom. A rom that can't be
+  // read is reported and skipped, the result is false if that happened to any of them.
+  bool extract_batch(const std::vector<batch_input_t>& inputs, extract_options_t options = {});
+
+  bool extract_bolt(const std::filesystem::path& input_file, const std::filesystem::path& output_dir, algorithm_t algorithm, std::endian byte_order, extract_options_t options = {});
+
+  enum flags_t {
+    FLAG_UNCOMPRESSED = 0x08
+  };
+
+  struct entry_t {
+    std::uint8_t flags;
+    std::uint8_t unk_1;
+
+    // If this is specified, calls an indexed special function which doesn't exist anywhere I've seen
+    std::uint8_t unk_2;
+    std::uint8_t file_type;
+    std::uint32_t uncompressed_size_be;
+    std::uint32_t data_offset_be;
+
+    // cleared and used as the uncompressed file pointer in official implementations
+    std::uint32_t file_hash_be;
+
+    // For code that already knows the archive's byte order at compile time, see with_byte_order
+    template<std::endian order> std::uint32_t uncompressed_size() const { return from_endian<order>(uncompressed_size_be); }
+    template<std::endian order> std::uint32_t data_offset() const { return from_endian<order>(data_offset_be); }
+    template<std::endian order> std::uint32_t file_hash() const { return from_endian<order>(file_hash_be); }
+
+    uint32_t uncompressed_size(std::endian order) const;
+    uint32_t data_offset(std::endian order) const;
+    uint32_t file_hash(std::endian order) const;
+  };
+
+  struct archive_t {
+    uint32_t magic; // 'B', 'O', 'L', 'T'
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t millisecond;
+    uint8_t month;
+    uint8_t day;
+    uint8_t year;   // Since 1900
+    uint8_t num_entries;
+    uint32_t end_offset;  // most of the time
+    entry_t entries[1];
+  };
+
+  struct archive_t_xbox {
+    uint32_t magic; // 'B', 'O', 'L', 'T'
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t month;
+    uint8_t day;
+    uint8_t year;   // Since 1900
+    uint16_t num_entries;
+    uint32_t end_offset;  // most of the time
+    entry_t entries[1];
+  };
+
+  class decoder_t;
+
+  class bolt_reader_t {
+  public:
+    struct work_item_t {
+      std::filesystem::path out_dir;
+      const entry_t* entry;
+      std::size_t bolt_begin;
+      unsigned index;
+    };
+
+    // Where one decoded entry goes, and the manifest row to fill in if any
+    struct file_output_t {
+      const work_item_t* item;
+      manifest_entry_t* record;
+    };
+
+    // What walk_archive does after visiting an entry. DESCEND is only followed for folders.
+    enum class walk_step_t {
+      NEXT,
+      DESCEND,
+      STOP,
+    };
+
+    // indices is the path to the entry, like 01A/003
+    using walk_visit_t = std::function<walk_step_t(const entry_t& entry, std::span<const unsigned> indices)>;
+    using walk_skip_t = std::function<void(std::span<const unsigned> indices, const std::string& problem)>;
+
+  private:
+    mapped_file_t rom_file;
+    std::span<const std::byte> rom;
+
+    algorithm_t algorithm;
+    std::endian byte_order;
+
+    // Every valid archive found in the rom, bolt_begin/archive point at the one being extracted
+    std::vector<std::size_t> archive_offsets;
+    std::size_t bolt_begin = 0;
+
+    const archive_t* archive;
+
+    const entry_t* entry_at(std::uint32_t offset) const;
+
+    // The table walk is instantiated per byte order and picked once per archive
+    template<std::endian order>
+    void walk_archive_as(std::size_t begin, const walk_visit_t& visit, const walk_skip_t& skip) const;
+
+    void find_bolt_archives();
+    void fall_back_to_first(const std::vector<std::size_t>& candidates);
+    void validate_archives(const std::vector<std::size_t>& candidates);
+    template<std::endian order>
+    bool is_valid_archive(std::size_t begin) const;
+    template<std::endian order>
+    unsigned declared_entries_of(const archive_t* header) const;
+    template<std::endian order>
+    unsigned num_entries_of(const archive_t* header) const;
+    void select_archive(std::size_t begin);
+    void write_result(output_writer_t& writer, std::filesystem::path filename, std::span<const std::byte> data, std::uint32_t filesize, bool quiet, bool in_rom);
+
+  public:
+    void read_from_file(const std::filesystem::path& filename);
+
+    // For pulling out a single entry: maps the rom and only validates the header at archive_begin,
+    // or scans up to the first one that passes. Nothing past that header is read.
+    void read_one_archive(const std::filesystem::path& filename, std::optional<std::size_t> archive_begin);
+
+    // Follows a path of one or more indices like 01A/003 from the top level table of the first archive,
+    // through the folder tables only. Throws if it doesn't lead to a file.
+    const entry_t& find_entry(std::span<const unsigned> indices);
+
+    // For trying formats on a rom that is already in memory, magics as found by find_bolt_magics.
+    // Unlike read_from_file there's no falling back to the first magic, false if none passed validation.
+    bool read_from_memory(std::span<const std::byte> data, const std::vector<std::size_t>& magics);
+
+    std::span<const std::byte> data() const { return rom; }
+    // Starts reading a range of the rom in the background, nothing happens for a rom given in memory
+    void prefetch(std::size_t offset, std::size_t size) const { rom_file.advise(offset, size, access_hint_t::WILLNEED); }
+    const std::vector<std::size_t>& archives() const { return archive_offsets; }
+    algorithm_t get_algorithm() const { return algorithm; }
+    std::endian get_byte_order() const { return byte_order; }
+
+    unsigned get_num_entries(const archive_t* header) const;
+    std::uint32_t get_dir_size(const entry_t& entry) const;
+
+    // Visits every entry of the archive at begin depth first, in table order. Every caller walks
+    // the tree through here: a folder table that lies outside the rom, that is one of the folder's
+    // own ancestors, or that would take the walk past a million entries goes to skip instead of
+    // being followed, so a damaged rom can't send the walk in circles. Folders sharing a table are
+    // each walked. Without skip those problems are reported on stderr.
+    void walk_archive(std::size_t begin, const walk_visit_t& visit, const walk_skip_t& skip = nullptr) const;
+
+    // One item per file in every archive found, each archive gets its own subdirectory if there is more than one
+    void collect_work(const std::filesystem::path& out_dir, std::vector<work_item_t>& work);
+    // Decodes the first output's entry and hands it to writer under the name of every output, which
+    // must all share that payload. Files are only on disk after writer.flush().
+    void extract_file(decoder_t& decoder, output_writer_t& writer, std::span<const file_output_t> outputs);
+
+    bolt_reader_t(algorithm_t algo, std::endian byte_order);
+  };
 }
\ No newline at end of file
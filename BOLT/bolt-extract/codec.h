@@ -0,0 +1,338 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <bit>
+#include <span>
+
+#include "util.h"
+
+
+namespace BOLT {
+  // The region a codec decodes into. Back references may reach down to begin, dst is the write
+  // position and decoding stops at end.
+  struct output_window_t {
+    std::byte* begin;
+    std::byte* dst;
+    std::byte* end;
+  };
+
+  enum class decode_status_t {
+    OUTPUT_FULL,    // reached the end of the window, call again with more room to continue
+    END_OF_STREAM,  // the codec hit its own terminator
+    ERROR,
+  };
+
+  enum class decode_error_kind_t : std::uint8_t {
+    NONE,
+    INPUT_OVERRUN,  // a token or its literal bytes run past the end of the input
+    LOOKBEHIND,     // a back reference reaches before the start of the window
+    SIZE_MISMATCH,  // the stream ended before the expected size, or the entry doesn't fit the rom
+    TRUNCATED,      // the last token runs past the expected size and was cut off
+  };
+
+  inline const char* error_kind_name(decode_error_kind_t kind) {
+    switch (kind) {
+    case decode_error_kind_t::INPUT_OVERRUN: return "input overrun";
+    case decode_error_kind_t::LOOKBEHIND: return "lookbehind";
+    case decode_error_kind_t::SIZE_MISMATCH: return "size mismatch";
+    case decode_error_kind_t::TRUNCATED: return "truncated";
+    default: return "";
+    }
+  }
+
+  struct decode_error_t {
+    decode_error_kind_t kind = decode_error_kind_t::NONE;
+    const char* message = nullptr;
+    std::size_t input_pos = 0;   // relative to the start of the entry's data
+    std::size_t output_pos = 0;  // bytes decoded before the failing token
+    std::uint8_t opcode = 0;
+
+    explicit operator bool() const { return kind != decode_error_kind_t::NONE; }
+  };
+
+  // Bounds checking policies for the codecs. Input and lookbehind are checked once per token, never
+  // per byte, so the checked instantiation runs close to the unchecked one.
+  struct checked_t {
+    static constexpr bool enabled = true;
+    static constexpr bool counting = false;
+  };
+
+  // Only for archives that already decoded cleanly with checks on, the codecs then trust every token
+  struct unchecked_t {
+    static constexpr bool enabled = false;
+    static constexpr bool counting = false;
+  };
+
+  // Checked, and fills in codec_stats_t on the way. Only used for --stats, the other two
+  // instantiations don't have a trace of the counting code.
+  struct counted_t {
+    static constexpr bool enabled = true;
+    static constexpr bool counting = true;
+  };
+
+  // Every token boils down to one of these. A token that doesn't fit in the window is parked as
+  // pending and finished on the next call.
+  enum class op_kind_t : std::uint8_t {
+    LITERAL,
+    MATCH,
+    FILL,
+    REVERSE,
+  };
+
+  // What the tokens of one codec amount to. Token classes mean something else for every codec, see
+  // token_class_name. Lengths and distances are counted in power of two buckets.
+  struct codec_stats_t {
+    static constexpr std::size_t MAX_CLASSES = 16;
+    static constexpr std::size_t BUCKETS = 33;  // std::bit_width of a 32 bit value
+
+    std::array<std::uint64_t, MAX_CLASSES> tokens{};
+    std::array<std::uint64_t, MAX_CLASSES> token_bytes{};  // output bytes
+    std::array<std::array<std::uint64_t, BUCKETS>, 4> lengths{};  // by op_kind_t
+    std::array<std::uint64_t, BUCKETS> distances{};  // of matches and reverse copies
+
+    void merge(const codec_stats_t& other) {
+      for (std::size_t i = 0; i < MAX_CLASSES; ++i) {
+        tokens[i] += other.tokens[i];
+        token_bytes[i] += other.token_bytes[i];
+      }
+      for (std::size_t i = 0; i < BUCKETS; ++i) {
+        for (std::size_t kind = 0; kind < lengths.size(); ++kind) {
+          lengths[kind][i] += other.lengths[kind][i];
+        }
+        distances[i] += other.distances[i];
+      }
+    }
+  };
+
+  struct pending_op_t {
+    op_kind_t kind;
+    std::uint32_t length;
+    std::uint32_t rel_offset;
+    std::byte value;
+  };
+
+  // Input cursor, pending ops and error reporting shared by all codecs. The token state machines
+  // live in the derived classes.
+  class codec_base_t {
+  protected:
+    std::span<const std::byte> input;
+    std::size_t input_pos = 0;
+
+    std::uint8_t opcode = 0;
+
+    // Windows codec tokens can expand to two single byte matches, which both may be left over
+    pending_op_t pending[2];
+    unsigned num_pending = 0;
+
+    decode_error_t error;
+
+    codec_stats_t* stats = nullptr;
+
+    std::byte read_u8() {
+      return input[input_pos++];
+    }
+
+    template<op_kind_t kind>
+    void execute_as(output_window_t& out, pending_op_t& op, std::uint32_t length) {
+      if constexpr (kind == op_kind_t::LITERAL) {
+        std::memcpy(out.dst, &input[input_pos], length);
+        input_pos += length;
+        out.dst += length;
+      }
+      else if constexpr (kind == op_kind_t::MATCH) {
+        reinsert_self(out.dst, op.rel_offset, length);
+      }
+      else if constexpr (kind == op_kind_t::FILL) {
+        std::memset(out.dst, std::to_integer<int>(op.value), length);
+        out.dst += length;
+      }
+      else {
+        reinsert_reversed(out.dst, op.rel_offset, length);
+        op.rel_offset += 2 * length;  // the source walks backwards while dst moves forwards
+      }
+      op.length -= length;
+    }
+
+    void execute(output_window_t& out, pending_op_t& op, std::uint32_t length) {
+      switch (op.kind) {
+      case op_kind_t::LITERAL: execute_as<op_kind_t::LITERAL>(out, op, length); break;
+      case op_kind_t::MATCH: execute_as<op_kind_t::MATCH>(out, op, length); break;
+      case op_kind_t::FILL: execute_as<op_kind_t::FILL>(out, op, length); break;
+      case op_kind_t::REVERSE: execute_as<op_kind_t::REVERSE>(out, op, length); break;
+      }
+    }
+
+    // Runs as much of op as fits. Returns false if some of it had to be left pending.
+    bool emit(output_window_t& out, pending_op_t op) {
+      if (num_pending != 0) {
+        pending[num_pending++] = op;
+        return false;
+      }
+
+      std::size_t room = out.end - out.dst;
+      if (op.length <= room) {
+        execute(out, op, op.length);
+        return true;
+      }
+
+      execute(out, op, static_cast<std::uint32_t>(room));
+      pending[num_pending++] = op;
+      return false;
+    }
+
+    // The usual case of a token that fits runs its kernel without going through execute's switch
+    template<op_kind_t kind>
+    bool emit_as(output_window_t& out, pending_op_t op) {
+      if (num_pending == 0 && op.length <= std::size_t(out.end - out.dst)) {
+        execute_as<kind>(out, op, op.length);
+        return true;
+      }
+      return emit(out, op);
+    }
+
+    bool emit_literal(output_window_t& out, std::uint32_t length) {
+      return emit_as<op_kind_t::LITERAL>(out, { op_kind_t::LITERAL, length, 0, std::byte(0) });
+    }
+    bool emit_match(output_window_t& out, std::uint32_t rel_offset, std::uint32_t length) {
+      return emit_as<op_kind_t::MATCH>(out, { op_kind_t::MATCH, length, rel_offset, std::byte(0) });
+    }
+    bool emit_fill(output_window_t& out, std::byte value, std::uint32_t length) {
+      return emit_as<op_kind_t::FILL>(out, { op_kind_t::FILL, length, 0, value });
+    }
+    bool emit_reverse(output_window_t& out, std::uint32_t rel_offset, std::uint32_t length) {
+      return emit_as<op_kind_t::REVERSE>(out, { op_kind_t::REVERSE, length, rel_offset, std::byte(0) });
+    }
+
+    bool flush_pending(output_window_t& out) {
+      for (unsigned i = 0; i < num_pending; ++i) {
+        std::size_t room = out.end - out.dst;
+        if (pending[i].length > room) {
+          execute(out, pending[i], static_cast<std::uint32_t>(room));
+          for (unsigned j = i; j < num_pending; ++j) {
+            pending[j - i] = pending[j];
+          }
+          num_pending -= i;
+          return false;
+        }
+        execute(out, pending[i], pending[i].length);
+      }
+      num_pending = 0;
+      return true;
+    }
+
+    // Whether n more input bytes are there. Always true without checks, so the test compiles away.
+    template<class check_t>
+    bool has_input(std::size_t n) const {
+      if constexpr (check_t::enabled) {
+        return input.size() - input_pos >= n;
+      }
+      return true;
+    }
+
+    // Whether the byte reach bytes behind the write position is inside the window. A zero reach is
+    // rejected too, the match kernels can't copy from dst itself.
+    template<class check_t>
+    static bool has_lookbehind(const output_window_t& out, std::size_t reach) {
+      if constexpr (check_t::enabled) {
+        return reach - 1 < std::size_t(out.dst - out.begin);
+      }
+      return true;
+    }
+
+    // Both compile to nothing unless check_t is counted_t. The first is for tokens that don't output anything.
+    template<class check_t>
+    void count(unsigned token_class) {
+      if constexpr (check_t::counting) {
+        stats->tokens[token_class]++;
+      }
+    }
+
+    template<class check_t>
+    void count(unsigned token_class, op_kind_t kind, std::uint32_t length, std::uint32_t distance = 0) {
+      if constexpr (check_t::counting) {
+        stats->tokens[token_class]++;
+        stats->token_bytes[token_class] += length;
+        stats->lengths[std::size_t(kind)][std::bit_width(length)]++;
+        if (kind == op_kind_t::MATCH || kind == op_kind_t::REVERSE) {
+          stats->distances[std::bit_width(distance)]++;
+        }
+      }
+    }
+
+    decode_status_t fail(const output_window_t& out, decode_error_kind_t kind, const char* msg) {
+      error = { kind, msg, input_pos, std::size_t(out.dst - out.begin), opcode };
+      return decode_status_t::ERROR;
+    }
+    decode_status_t fail_input(const output_window_t& out) {
+      return fail(out, decode_error_kind_t::INPUT_OVERRUN, "compressed data runs past the end of the rom");
+    }
+    decode_status_t fail_lookbehind(const output_window_t& out) {
+      return fail(out, decode_error_kind_t::LOOKBEHIND, "lookbehind too far");
+    }
+
+  public:
+    std::size_t input_position() const { return input_pos; }
+    std::uint8_t last_opcode() const { return opcode; }
+    const char* error_message() const { return error.message; }
+    const decode_error_t& last_error() const { return error; }
+
+    // Output a token produced that didn't fit in the window yet
+    bool has_pending() const { return num_pending != 0; }
+
+    // Where the counted_t instantiation keeps its statistics, ignored by the others
+    void collect_stats(codec_stats_t* stats) { this->stats = stats; }
+
+    explicit codec_base_t(std::span<const std::byte> input)
+      : input(input) {}
+  };
+
+  // The codecs below are instantiated for checked_t, unchecked_t and counted_t in their own source files
+
+  // N64, GBA, XBOX and PS2. Offsets grow with every extension token, so there is no natural window size.
+  template<class check_t>
+  class n64_codec_t : public codec_base_t {
+  private:
+    std::uint32_t op_count = 0;
+    std::uint32_t ext_offset = 0;
+    std::uint32_t ext_run = 0;
+
+  public:
+    static constexpr std::size_t WINDOW_SIZE = 1 << 20;
+
+    decode_status_t run(output_window_t& out);
+    using codec_base_t::codec_base_t;
+  };
+
+  // MS-DOS and later CD-i
+  template<class check_t>
+  class dos_codec_t : public codec_base_t {
+  public:
+    static constexpr std::size_t WINDOW_SIZE = 512;
+
+    decode_status_t run(output_window_t& out);
+    using codec_base_t::codec_base_t;
+  };
+
+  // Early CD-i
+  template<class check_t>
+  class cdi_codec_t : public codec_base_t {
+  public:
+    // A split reverse copy reaches back up to 0x3FF + 2 * 0x403 bytes
+    static constexpr std::size_t WINDOW_SIZE = 4096;
+
+    decode_status_t run(output_window_t& out);
+    using codec_base_t::codec_base_t;
+  };
+
+  // The Game of Life
+  template<class check_t>
+  class win_codec_t : public codec_base_t {
+  public:
+    static constexpr std::size_t WINDOW_SIZE = 512;
+
+    decode_status_t run(output_window_t& out);
+    using codec_base_t::codec_base_t;
+  };
+}
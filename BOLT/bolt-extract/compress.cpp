@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstdint>
+#include <bit>
+
+#include "compress.h"
+
+
+using namespace BOLT;
+
+namespace {
+  struct level_params_t {
+    unsigned chain_depth;  // candidates looked at per position
+    unsigned window_bits;  // furthest back a match may reach
+    unsigned nice_length;  // stop searching once a match is this long
+    bool lazy;             // check whether the next position has a better match first
+  };
+
+  constexpr level_params_t LEVELS[] = {
+    {    4, 16,    32, false },
+    {    8, 16,    64, false },
+    {   16, 16,   128, false },
+    {   16, 16,   128, true },
+    {   32, 17,   256, true },
+    {   64, 17,   256, true },
+    {  128, 18,   512, true },
+    {  256, 18,  1024, true },
+    { 1024, 20, 65536, true },
+  };
+
+  constexpr unsigned HASH_BITS = 16;
+  constexpr std::uint32_t MAX_MATCH = 65536;
+  constexpr std::uint32_t LITERAL_CHUNK = 512;  // longest literal run that needs at most one extension token
+
+  // Number of `bits` sized extension tokens needed to hold value
+  unsigned ext_groups(std::uint32_t value, unsigned bits) {
+    unsigned groups = 0;
+    for (; value != 0; value >>= bits) groups++;
+    return groups;
+  }
+
+  // Every token of a match adds one to its run length, so a match with k extension tokens encodes
+  // length - 2 - k. Finds the smallest k that holds both the offset and the rest of the length.
+  unsigned match_ext_tokens(std::uint32_t rel_offset, std::uint32_t length) {
+    unsigned offset_tokens = ext_groups((rel_offset - 1) >> 4, 6);
+    for (unsigned k = offset_tokens;; ++k) {
+      if (k + 2 > length) return length;  // too short to reach that far, never a gain
+      std::uint32_t v = length - 2 - k;
+      if (offset_tokens + ext_groups(v >> 3, 5) <= k) return k;
+    }
+  }
+
+  class n64_encoder_t {
+  private:
+    std::span<const std::byte> data;
+    level_params_t params;
+    std::vector<std::byte> out;
+
+    std::vector<std::int32_t> head;
+    std::vector<std::int32_t> prev;
+    std::uint32_t window_mask;
+
+    std::uint32_t literal_start = 0;
+
+    void put(unsigned value) { out.push_back(static_cast<std::byte>(value)); }
+
+    void put_ext(std::uint32_t value, unsigned bits, unsigned tag, unsigned count) {
+      for (unsigned i = count; i-- > 0;) {
+        put(tag | ((value >> (i * bits)) & ((1u << bits) - 1)));
+      }
+    }
+
+    std::uint32_t hash_at(std::uint32_t pos) const {
+      std::uint32_t v = std::to_integer<std::uint32_t>(data[pos]) | (std::to_integer<std::uint32_t>(data[pos + 1]) << 8) | (std::to_integer<std::uint32_t>(data[pos + 2]) << 16);
+      return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    void insert(std::uint32_t pos) {
+      if (pos + 3 > data.size()) return;
+      std::uint32_t h = hash_at(pos);
+      prev[pos & window_mask] = head[h];
+      head[h] = static_cast<std::int32_t>(pos);
+    }
+
+    // Bytes saved by encoding length bytes as this match instead of literals
+    static int match_gain(std::uint32_t rel_offset, std::uint32_t length) {
+      if (length < 2) return 0;
+      return int(length) - 1 - int(match_ext_tokens(rel_offset, length));
+    }
+
+    struct match_t {
+      std::uint32_t rel_offset = 0;
+      std::uint32_t length = 0;
+      int gain = 0;
+    };
+
+    match_t find_match(std::uint32_t pos) const {
+      match_t best;
+      if (pos + 3 > data.size()) return best;
+
+      std::uint32_t max_length = std::min<std::uint32_t>(MAX_MATCH, static_cast<std::uint32_t>(data.size()) - pos);
+      std::uint32_t window = window_mask + 1;
+
+      std::int32_t candidate = head[hash_at(pos)];
+      for (unsigned depth = 0; candidate >= 0 && depth < params.chain_depth && best.length < max_length; ++depth) {
+        std::uint32_t rel_offset = pos - static_cast<std::uint32_t>(candidate);
+        if (rel_offset > window - 1) break;
+
+        const std::byte* a = &data[candidate];
+        const std::byte* b = &data[pos];
+        if (a[best.length] == b[best.length]) {
+          std::uint32_t length = 0;
+          while (length < max_length && a[length] == b[length]) length++;
+
+          int gain = match_gain(rel_offset, length);
+          if (gain > best.gain) {
+            best = { rel_offset, length, gain };
+            if (length >= params.nice_length) break;
+          }
+        }
+        candidate = prev[candidate & window_mask];
+      }
+      return best;
+    }
+
+    void flush_literals(std::uint32_t end) {
+      while (literal_start < end) {
+        std::uint32_t length = std::min(end - literal_start, LITERAL_CHUNK);
+        std::uint32_t v = length - 1;
+        put_ext(v >> 4, 5, 0xA0, ext_groups(v >> 4, 5));
+        put(0x80 | (v & 0xF));
+        out.insert(out.end(), data.begin() + literal_start, data.begin() + literal_start + length);
+        literal_start += length;
+      }
+    }
+
+    void emit_match(std::uint32_t rel_offset, std::uint32_t length) {
+      std::uint32_t o = rel_offset - 1;
+      unsigned k = match_ext_tokens(rel_offset, length);
+      std::uint32_t v = length - 2 - k;
+
+      unsigned offset_tokens = ext_groups(o >> 4, 6);
+      unsigned run_tokens = ext_groups(v >> 3, 5);
+
+      // Filler offset tokens shift in zeroes, ahead of the real ones they don't change anything
+      for (unsigned i = offset_tokens + run_tokens; i < k; ++i) put(0xC0);
+      put_ext(o >> 4, 6, 0xC0, offset_tokens);
+      put_ext(v >> 3, 5, 0xA0, run_tokens);
+      put(((v & 7) << 4) | (o & 0xF));
+    }
+
+  public:
+    std::vector<std::byte> run() {
+      std::uint32_t size = static_cast<std::uint32_t>(data.size());
+      std::uint32_t pos = 0;
+
+      while (pos < size) {
+        match_t match = find_match(pos);
+        if (match.gain <= 0) {
+          insert(pos++);
+          continue;
+        }
+
+        if (params.lazy && pos + 1 < size) {
+          insert(pos);
+          match_t next = find_match(pos + 1);
+          if (next.gain > match.gain) {
+            pos++;
+            continue;
+          }
+          pos++;
+        }
+        else {
+          insert(pos++);
+        }
+
+        // pos is one past the match start here, its hash is already in
+        std::uint32_t start = pos - 1;
+        flush_literals(start);
+        emit_match(match.rel_offset, match.length);
+
+        std::uint32_t end = start + match.length;
+        for (; pos < end; ++pos) insert(pos);
+        literal_start = end;
+      }
+
+      flush_literals(size);
+      return std::move(out);
+    }
+
+    n64_encoder_t(std::span<const std::byte> data, int level)
+      : data(data), params(LEVELS[std::clamp(level, COMPRESS_LEVEL_MIN, COMPRESS_LEVEL_MAX) - 1]),
+        head(std::size_t(1) << HASH_BITS, -1) {
+      // No point in a window bigger than the file, small files are the common case
+      unsigned window_bits = std::min<unsigned>(params.window_bits, std::max<unsigned>(std::bit_width(data.size()), 4));
+      window_mask = (1u << window_bits) - 1;
+      prev.assign(std::size_t(1) << window_bits, -1);
+      out.reserve(data.size() / 2 + 16);
+    }
+  };
+}
+
+std::vector<std::byte> BOLT::compress_n64(std::span<const std::byte> data, int level) {
+  return n64_encoder_t{ data, level }.run();
+}
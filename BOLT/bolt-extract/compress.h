@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <span>
+
+
+namespace BOLT {
+  // 1 is fastest, 9 searches hardest. Level 0 means entries are stored, it isn't valid here.
+  constexpr int COMPRESS_LEVEL_MIN = 1;
+  constexpr int COMPRESS_LEVEL_MAX = 9;
+
+  // Encodes data in the N64/GBA/XBOX/PS2 token format, which n64_codec_t decodes
+  std::vector<std::byte> compress_n64(std::span<const std::byte> data, int level);
+}
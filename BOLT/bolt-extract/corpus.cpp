@@ -0,0 +1,473 @@
+#include <algorithm>
+
+#include "corpus.h"
+#include "repack.h"
+#include "codec.h"
+#include "util.h"
+
+
+using namespace BOLT;
+
+namespace {
+  // splitmix64, std::uniform_int_distribution differs between standard libraries
+  class synth_rng_t {
+  private:
+    std::uint64_t state;
+
+  public:
+    std::uint64_t next() {
+      std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      return z ^ (z >> 31);
+    }
+
+    std::uint32_t below(std::uint32_t n) { return static_cast<std::uint32_t>(next() % n); }
+    std::uint32_t range(std::uint32_t lo, std::uint32_t hi) { return lo + below(hi - lo + 1); }
+    std::byte byte() { return static_cast<std::byte>(next()); }
+
+    explicit synth_rng_t(std::uint64_t seed) : state(seed) {}
+  };
+
+  struct synth_op_t {
+    op_kind_t kind;
+    std::uint32_t length;
+    std::uint32_t rel_offset;
+    std::byte value;
+  };
+
+  struct shape_mix_t {
+    unsigned literal_pct;
+    unsigned match_pct;
+    std::uint32_t literal_max;
+    std::uint32_t match_max;
+    std::uint32_t fill_max;
+  };
+
+  shape_mix_t shape_mix(corpus_shape_t shape) {
+    switch (shape) {
+    case corpus_shape_t::LITERAL: return { 85, 10, 256, 32, 64 };
+    case corpus_shape_t::MATCH:   return { 10, 85, 16, 512, 64 };
+    case corpus_shape_t::RLE:     return { 20, 10, 32, 64, 4096 };
+    default:                      return { 40, 45, 64, 256, 512 };
+    }
+  }
+
+  // Furthest back reference each codec can express
+  std::uint32_t max_rel_offset(algorithm_t algorithm) {
+    switch (algorithm) {
+    case algorithm_t::CDI: return 1024;
+    case algorithm_t::DOS:
+    case algorithm_t::WIN: return 511;
+    default: return 65536;
+    }
+  }
+
+  // Picks a sequence of ops for one file and builds the data they produce
+  std::vector<synth_op_t> plan_file(synth_rng_t& rng, corpus_shape_t shape, std::uint32_t max_offset, std::vector<std::byte>& data, std::uint32_t size) {
+    shape_mix_t mix = shape_mix(shape);
+    std::vector<synth_op_t> ops;
+
+    while (data.size() < size) {
+      std::uint32_t pos = static_cast<std::uint32_t>(data.size());
+      std::uint32_t remaining = size - pos;
+      unsigned roll = rng.below(100);
+
+      if (roll < mix.literal_pct || pos == 0) {
+        std::uint32_t length = std::min(rng.range(1, mix.literal_max), remaining);
+        for (std::uint32_t i = 0; i < length; ++i) data.push_back(rng.byte());
+        ops.push_back({ op_kind_t::LITERAL, length, 0, std::byte(0) });
+      }
+      else if (roll < mix.literal_pct + mix.match_pct) {
+        // Mostly close references, like real data, with the odd far one
+        std::uint32_t reach = std::min(pos, rng.below(4) == 0 ? max_offset : 64u);
+        std::uint32_t rel_offset = rng.range(1, reach);
+        std::uint32_t length = std::min(rng.range(2, mix.match_max), remaining);
+        for (std::uint32_t i = 0; i < length; ++i) data.push_back(data[data.size() - rel_offset]);
+        ops.push_back({ op_kind_t::MATCH, length, rel_offset, std::byte(0) });
+      }
+      else {
+        std::byte value = rng.below(4) == 0 ? std::byte(0) : rng.byte();
+        std::uint32_t length = std::min(rng.range(8, mix.fill_max), remaining);
+        data.insert(data.end(), length, value);
+        ops.push_back({ op_kind_t::FILL, length, 0, value });
+      }
+    }
+    return ops;
+  }
+
+  // Each encoder turns ops into its codec's tokens, falling back to literals for anything the
+  // codec can't express
+  class token_writer_t {
+  protected:
+    std::vector<std::byte>& out;
+    std::span<const std::byte> data;
+    std::uint32_t pos = 0;
+
+    void put(unsigned value) { out.push_back(static_cast<std::byte>(value)); }
+    void put_data(std::uint32_t length) {
+      out.insert(out.end(), data.begin() + pos, data.begin() + pos + length);
+    }
+
+  public:
+    token_writer_t(std::vector<std::byte>& out, std::span<const std::byte> data)
+      : out(out), data(data) {}
+  };
+
+  class n64_writer_t : public token_writer_t {
+  private:
+    // Extension tokens hold the high bits of a value, most significant group first
+    void put_ext(std::vector<unsigned>& tokens, std::uint32_t value, unsigned bits, unsigned tag) {
+      std::size_t first = tokens.size();
+      for (; value != 0; value >>= bits) {
+        tokens.push_back(tag | (value & ((1u << bits) - 1)));
+      }
+      std::reverse(tokens.begin() + first, tokens.end());
+    }
+
+  public:
+    void literal(std::uint32_t length) {
+      while (length != 0) {
+        std::uint32_t chunk = std::min(length, 4096u);
+        std::vector<unsigned> tokens;
+        put_ext(tokens, (chunk - 1) >> 4, 5, 0xA0);
+        for (unsigned t : tokens) put(t);
+        put(0x80 | ((chunk - 1) & 0xF));
+        put_data(chunk);
+
+        pos += chunk;
+        length -= chunk;
+      }
+    }
+
+    void match(std::uint32_t rel_offset, std::uint32_t length) {
+      // Every token of a match adds one to its run length, so try k extension tokens until they fit
+      for (std::uint32_t k = 0; k + 2 <= length; ++k) {
+        std::uint32_t v = length - 2 - k;
+        std::vector<unsigned> tokens;
+        put_ext(tokens, (rel_offset - 1) >> 4, 6, 0xC0);
+        put_ext(tokens, v >> 3, 5, 0xA0);
+        if (tokens.size() > k) continue;
+
+        for (std::size_t pad = tokens.size(); pad < k; ++pad) put(0xC0);
+        for (unsigned t : tokens) put(t);
+        put(((v & 7) << 4) | ((rel_offset - 1) & 0xF));
+        pos += length;
+        return;
+      }
+      literal(length);
+    }
+
+    void fill(std::byte, std::uint32_t length) {
+      literal(1);
+      if (length >= 3) match(1, length - 1);
+      else literal(length - 1);
+    }
+
+    void finish() {}
+
+    using token_writer_t::token_writer_t;
+  };
+
+  class dos_writer_t : public token_writer_t {
+  public:
+    void literal(std::uint32_t length) {
+      while (length != 0) {
+        std::uint32_t chunk = std::min(length, 31u);
+        put(31 - chunk);
+        put_data(chunk);
+        pos += chunk;
+        length -= chunk;
+      }
+    }
+
+    void match(std::uint32_t rel_offset, std::uint32_t length) {
+      while (length >= 4) {
+        if (rel_offset % 2 == 0 && rel_offset <= 510 && length >= 36) {
+          std::uint32_t chunk = std::min(length, 130u) & ~1u;
+          put(0x80 | (chunk % 4 ? 0x20 : 0) | (32 - chunk / 4));
+          put(rel_offset / 2);
+          pos += chunk;
+          length -= chunk;
+        }
+        else {
+          std::uint32_t chunk = std::min(length, 35u);
+          put(0x40 | (rel_offset >= 256 ? 0x20 : 0) | (35 - chunk));
+          put(rel_offset & 0xFF);
+          pos += chunk;
+          length -= chunk;
+        }
+      }
+      literal(length);
+    }
+
+    void fill(std::byte value, std::uint32_t length) {
+      while (length >= 4) {
+        std::uint32_t quads = std::min(length / 4, 8192u);
+        std::uint32_t run = (quads - 1) / 32;
+        put(0xC0 | (32 - (quads - 32 * run)));
+        put(run);
+        put(0);
+        put(std::to_integer<unsigned>(value));
+        pos += 4 * quads;
+        length -= 4 * quads;
+      }
+      literal(length);
+    }
+
+    void finish() {}
+
+    using token_writer_t::token_writer_t;
+  };
+
+  class cdi_writer_t : public token_writer_t {
+  public:
+    void literal(std::uint32_t length) {
+      while (length != 0) {
+        std::uint32_t chunk = std::min(length, 32u);
+        put(chunk - 1);
+        put_data(chunk);
+        pos += chunk;
+        length -= chunk;
+      }
+    }
+
+    void match(std::uint32_t rel_offset, std::uint32_t length) {
+      if (rel_offset <= 16) {
+        while (length != 0) {
+          std::uint32_t chunk = std::min(length, 65535u);
+          put(0xA0 | (rel_offset - 1));
+          put(chunk >> 8);
+          put(chunk & 0xFF);
+          pos += chunk;
+          length -= chunk;
+        }
+        return;
+      }
+
+      std::uint32_t o = rel_offset - 1;
+      while (length >= 4) {
+        std::uint32_t chunk = std::min(length, 1027u);
+        put(0xB0 | (o >> 6));
+        put(((o & 0x3F) << 2) | ((chunk - 4) >> 8));
+        put((chunk - 4) & 0xFF);
+        pos += chunk;
+        length -= chunk;
+      }
+      if (length == 3) {
+        put(0x90 | (o >> 6));
+        put((o & 0x3F) << 2);
+        pos += 3;
+        return;
+      }
+      literal(length);
+    }
+
+    void fill(std::byte value, std::uint32_t length) {
+      if (value == std::byte(0)) {
+        while (length != 0) {
+          std::uint32_t chunk = std::min(length, 16u);
+          put(0x20 | (chunk - 1));
+          pos += chunk;
+          length -= chunk;
+        }
+        return;
+      }
+
+      while (length >= 3) {
+        std::uint32_t chunk = std::min(length, 18u);
+        put(0x30 | (chunk - 3));
+        put(std::to_integer<unsigned>(value));
+        pos += chunk;
+        length -= chunk;
+      }
+      literal(length);
+    }
+
+    void finish() {}
+
+    using token_writer_t::token_writer_t;
+  };
+
+  class win_writer_t : public token_writer_t {
+  public:
+    void literal(std::uint32_t length) {
+      while (length != 0) {
+        std::uint32_t chunk = std::min(length, 15u);
+        put(chunk);
+        put_data(chunk);
+        pos += chunk;
+        length -= chunk;
+      }
+    }
+
+    void match(std::uint32_t rel_offset, std::uint32_t length) {
+      while (length >= 3) {
+        std::uint32_t chunk = std::min(length, 18u);
+        put(0x20 | ((rel_offset & 1) << 4) | (chunk - 3));
+        put(rel_offset >> 1);
+        pos += chunk;
+        length -= chunk;
+      }
+      if (length == 2 && rel_offset >= 9 && rel_offset <= 88) {
+        put(rel_offset + 103);
+        pos += 2;
+        return;
+      }
+      literal(length);
+    }
+
+    void fill(std::byte value, std::uint32_t length) {
+      if (value == std::byte(0)) {
+        while (length >= 2) {
+          std::uint32_t chunk = std::min(length, 17u);
+          put(0x60 | (chunk - 2));
+          pos += chunk;
+          length -= chunk;
+        }
+        literal(length);
+        return;
+      }
+
+      while (length >= 19) {
+        std::uint32_t steps = std::min((length - 19) / 4, 4095u);
+        put(0x50 | (steps & 0xF));
+        put(steps >> 4);
+        put(std::to_integer<unsigned>(value));
+        pos += 4 * steps + 19;
+        length -= 4 * steps + 19;
+      }
+      while (length >= 3) {
+        std::uint32_t chunk = std::min(length, 18u);
+        put(0x40 | (chunk - 3));
+        put(std::to_integer<unsigned>(value));
+        pos += chunk;
+        length -= chunk;
+      }
+      literal(length);
+    }
+
+    void finish() { put(0); }
+
+    using token_writer_t::token_writer_t;
+  };
+
+  template<class writer_t>
+  void encode_ops(std::vector<std::byte>& out, std::span<const std::byte> data, const std::vector<synth_op_t>& ops) {
+    writer_t writer{ out, data };
+    for (const synth_op_t& op : ops) {
+      switch (op.kind) {
+      case op_kind_t::LITERAL: writer.literal(op.length); break;
+      case op_kind_t::MATCH: writer.match(op.rel_offset, op.length); break;
+      case op_kind_t::FILL: writer.fill(op.value, op.length); break;
+      default: break;
+      }
+    }
+    writer.finish();
+  }
+
+  void encode(algorithm_t algorithm, std::vector<std::byte>& out, std::span<const std::byte> data, const std::vector<synth_op_t>& ops) {
+    switch (algorithm) {
+    case algorithm_t::CDI: encode_ops<cdi_writer_t>(out, data, ops); break;
+    case algorithm_t::DOS: encode_ops<dos_writer_t>(out, data, ops); break;
+    case algorithm_t::WIN: encode_ops<win_writer_t>(out, data, ops); break;
+    default: encode_ops<n64_writer_t>(out, data, ops); break;
+    }
+  }
+
+  class archive_builder_t {
+  private:
+    algorithm_t algorithm;
+    std::endian byte_order;
+    corpus_shape_t shape;
+    synth_rng_t rng;
+
+    std::size_t remaining;
+
+    // What each file should decode to, in the same depth first order as the tree
+    std::vector<std::uint64_t> hashes;
+
+    pack_node_t make_file(std::uint32_t size) {
+      pack_node_t file;
+      std::vector<std::byte> data;
+      data.reserve(size);
+      std::vector<synth_op_t> ops = plan_file(rng, shape, max_rel_offset(algorithm), data, size);
+
+      hashes.push_back(fnv1a_64(data));
+      file.uncompressed_size = size;
+      file.file_type = 1;
+      file.file_hash = static_cast<std::uint32_t>(hashes.back()) | 1;
+
+      if (shape == corpus_shape_t::NESTED && rng.below(10) == 0) {
+        file.flags = FLAG_UNCOMPRESSED;
+        file.payload = std::move(data);
+      }
+      else {
+        encode(algorithm, file.payload, data, ops);
+      }
+      remaining -= std::min<std::size_t>(remaining, size);
+      return file;
+    }
+
+    std::uint32_t next_file_size() {
+      std::uint32_t size = shape == corpus_shape_t::NESTED ? rng.range(1024, 16 * 1024) : 256 * 1024;
+      return static_cast<std::uint32_t>(std::min<std::size_t>(size, std::max<std::size_t>(remaining, 1)));
+    }
+
+    // Folders of up to `width` entries, `depth` levels of them above the files
+    pack_node_t make_dir(unsigned depth, unsigned width) {
+      pack_node_t dir;
+      dir.is_dir = true;
+      while (remaining != 0 && dir.children.size() < width) {
+        dir.children.push_back(depth == 0 ? make_file(next_file_size()) : make_dir(depth - 1, width));
+      }
+      return dir;
+    }
+
+    void collect_files(const pack_node_t& dir, synthetic_archive_t& result) {
+      for (const pack_node_t& child : dir.children) {
+        if (child.is_dir) {
+          collect_files(child, result);
+          continue;
+        }
+        result.files.push_back({ child.entry_offset, child.uncompressed_size, hashes[result.files.size()] });
+        result.uncompressed_size += child.uncompressed_size;
+      }
+    }
+
+  public:
+    synthetic_archive_t build() {
+      pack_node_t root;
+      if (shape == corpus_shape_t::NESTED) {
+        root = make_dir(3, 16);
+      }
+      else {
+        // Flat unless there are more files than one table holds
+        std::size_t num_files = (remaining + 256 * 1024 - 1) / (256 * 1024);
+        root = num_files <= 256 ? make_dir(0, 256) : make_dir(1, 256);
+      }
+
+      synthetic_archive_t result;
+      result.rom = write_archive(root, algorithm, byte_order);
+      collect_files(root, result);
+      return result;
+    }
+
+    archive_builder_t(algorithm_t algorithm, std::endian byte_order, corpus_shape_t shape, std::size_t uncompressed_size, std::uint64_t seed)
+      : algorithm(algorithm), byte_order(byte_order), shape(shape), rng(seed), remaining(std::max<std::size_t>(uncompressed_size, 1)) {}
+  };
+}
+
+const char* BOLT::shape_name(corpus_shape_t shape) {
+  switch (shape) {
+  case corpus_shape_t::LITERAL: return "literal";
+  case corpus_shape_t::MATCH: return "match";
+  case corpus_shape_t::RLE: return "rle";
+  case corpus_shape_t::NESTED: return "nested";
+  }
+  return "";
+}
+
+synthetic_archive_t BOLT::make_synthetic_archive(algorithm_t algorithm, std::endian byte_order, corpus_shape_t shape, std::size_t uncompressed_size, std::uint64_t seed) {
+  return archive_builder_t{ algorithm, byte_order, shape, uncompressed_size, seed }.build();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <bit>
+#include <span>
+
+#include "bolt.h"
+
+
+namespace BOLT {
+  // Which token mix the synthetic entries are made of
+  enum class corpus_shape_t {
+    LITERAL,  // mostly incompressible literal runs
+    MATCH,    // mostly back references
+    RLE,      // mostly long fills
+    NESTED,   // a mix of everything, in many small files three folders deep
+  };
+
+  const char* shape_name(corpus_shape_t shape);
+
+  struct synthetic_file_t {
+    std::size_t entry_offset;  // of the entry_t in rom
+    std::uint32_t size;
+    std::uint64_t hash;        // fnv1a_64 of the data the entry must decode to
+  };
+
+  // A complete archive at offset 0 of rom, plus what every file in it should decode to
+  struct synthetic_archive_t {
+    std::vector<std::byte> rom;
+    std::vector<synthetic_file_t> files;
+    std::size_t uncompressed_size = 0;
+  };
+
+  // Deterministic for a given seed, on every platform and compiler
+  synthetic_archive_t make_synthetic_archive(algorithm_t algorithm, std::endian byte_order, corpus_shape_t shape, std::size_t uncompressed_size, std::uint64_t seed);
+}
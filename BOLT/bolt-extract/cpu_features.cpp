@@ -0,0 +1,39 @@
+#include "cpu_features.h"
+
+
+bool BOLT::cpu_has_sse2() {
+#if defined(_M_X64) || defined(__x86_64__)
+  return true;
+#elif defined(BOLT_X86) && defined(_MSC_VER)
+  int regs[4];
+  __cpuid(regs, 1);
+  return (regs[3] & (1 << 26)) != 0;
+#elif defined(BOLT_X86)
+  __builtin_cpu_init();  // may run from a static initializer, before libgcc has done it
+  return __builtin_cpu_supports("sse2");
+#else
+  return false;
+#endif
+}
+
+bool BOLT::cpu_has_avx2() {
+#if defined(BOLT_X86) && defined(_MSC_VER)
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] < 7) return false;
+
+  __cpuid(regs, 1);
+  bool osxsave = (regs[2] & (1 << 27)) != 0;
+  bool avx = (regs[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx) return false;
+  if ((_xgetbv(0) & 0x6) != 0x6) return false;  // OS saves the YMM registers
+
+  __cpuidex(regs, 7, 0);
+  return (regs[1] & (1 << 5)) != 0;
+#elif defined(BOLT_X86)
+  __builtin_cpu_init();  // may run from a static initializer, before libgcc has done it
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BOLT_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define BOLT_TARGET(x)
+#else
+// GCC and clang only emit vector instructions in functions that are marked for them
+#define BOLT_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+
+namespace BOLT {
+  bool cpu_has_sse2();
+  bool cpu_has_avx2();
+}
@@ -0,0 +1,134 @@
+#include <string>
+#include <iostream>
+#include <sstream>
+#include "decoder.h"
+#include "codec.h"
+
+
+using namespace BOLT;
+
+decoder_t::decoder_t(std::span<const std::byte> rom, std::size_t bolt_begin, algorithm_t algo, std::endian byte_order)
+  : rom(rom), algorithm(algo), byte_order(byte_order), bolt_begin(bolt_begin) {}
+
+void decoder_t::bind(std::span<const std::byte> rom, std::size_t bolt_begin, algorithm_t algo, std::endian byte_order) {
+  this->rom = rom;
+  this->bolt_begin = bolt_begin;
+  this->algorithm = algo;
+  this->byte_order = byte_order;
+}
+
+void decoder_t::enable_stats() {
+  stats.resize(std::size_t(algorithm_t::XBOX) + 1);
+}
+
+void decoder_t::err_msg(const std::string& msg, std::uint8_t value) {
+  if (quiet) return;
+  // Built up front so messages from different workers don't interleave
+  std::ostringstream ss;
+  ss << msg << "; value " << std::uint32_t(value) << " at offset " << std::hex << cursor_pos << " (BOLT+" << (cursor_pos - bolt_begin) << "); Filetype: " << std::uint32_t(current_filetype) << "\n";
+  std::cerr << ss.str();
+}
+
+template<class codec_t>
+std::size_t decoder_t::decompress(std::uint32_t offset, std::span<std::byte> out) {
+  codec_t codec{ rom.subspan(bolt_begin + offset) };
+  codec.collect_stats(active_stats);
+  output_window_t window{ out.data(), out.data(), out.data() + out.size() };
+
+  decode_status_t status = codec.run(window);
+  cursor_pos = bolt_begin + offset + codec.input_position();
+
+  std::size_t result_size = window.dst - window.begin;
+  if (status == decode_status_t::ERROR) {
+    error = codec.last_error();
+    err_msg(codec.error_message(), codec.last_opcode());
+  }
+  else if (status == decode_status_t::END_OF_STREAM && result_size != out.size()) {
+    error = { decode_error_kind_t::SIZE_MISMATCH, "finished decompression with invalid size", codec.input_position(), result_size, codec.last_opcode() };
+
+    std::ostringstream ss;
+    ss << "finished decompression with invalid size; Expected size: " << out.size() << "; Got: " << result_size;
+    err_msg(ss.str(), codec.last_opcode());
+  }
+  else if (codec.has_pending()) {
+    error = { decode_error_kind_t::TRUNCATED, "run goes past the expected size, truncating", codec.input_position(), result_size, codec.last_opcode() };
+    err_msg(error.message, codec.last_opcode());
+  }
+  return result_size;
+}
+
+template std::size_t decoder_t::decompress<n64_codec_t<checked_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<dos_codec_t<checked_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<cdi_codec_t<checked_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<win_codec_t<checked_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<n64_codec_t<unchecked_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<dos_codec_t<unchecked_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<cdi_codec_t<unchecked_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<win_codec_t<unchecked_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<n64_codec_t<counted_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<dos_codec_t<counted_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<cdi_codec_t<counted_t>>(std::uint32_t offset, std::span<std::byte> out);
+template std::size_t decoder_t::decompress<win_codec_t<counted_t>>(std::uint32_t offset, std::span<std::byte> out);
+
+template<class check_t, std::endian order>
+std::span<const std::byte> decoder_t::decode_as(const entry_t& entry) {
+  std::uint32_t expected_size = entry.uncompressed_size<order>();
+  std::uint32_t offset = entry.data_offset<order>();
+
+  this->current_filetype = entry.file_type;
+  this->error = {};
+  this->input_size = 0;
+
+  if constexpr (check_t::enabled) {
+    std::size_t available = rom.size() - bolt_begin;
+    std::size_t needed = (entry.flags & FLAG_UNCOMPRESSED) ? expected_size : 0;
+    if (offset > available || needed > available - offset) {
+      cursor_pos = bolt_begin + offset;
+      error = { decode_error_kind_t::INPUT_OVERRUN, "entry data lies outside the rom", 0, 0, 0 };
+      err_msg(error.message, 0);
+      return {};
+    }
+  }
+
+  if (entry.flags & FLAG_UNCOMPRESSED) {
+    input_size = expected_size;
+    return rom.subspan(bolt_begin + offset, expected_size);
+  }
+
+  if (buffer.size() < expected_size) buffer.resize(expected_size);
+  std::span<std::byte> out{ buffer.data(), expected_size };
+
+  std::size_t result_size = 0;
+  cursor_pos = bolt_begin + offset;
+  if constexpr (check_t::counting) {
+    active_stats = &stats[std::size_t(algorithm)];
+  }
+  switch (algorithm) {
+  case algorithm_t::CDI:
+    result_size = decompress<cdi_codec_t<check_t>>(offset, out);
+    break;
+  case algorithm_t::DOS:
+    result_size = decompress<dos_codec_t<check_t>>(offset, out);
+    break;
+  case algorithm_t::N64:
+  case algorithm_t::XBOX:
+    result_size = decompress<n64_codec_t<check_t>>(offset, out);
+    break;
+  case algorithm_t::WIN:
+    result_size = decompress<win_codec_t<check_t>>(offset, out);
+    break;
+  }
+  input_size = cursor_pos - (bolt_begin + offset);
+  return out.first(result_size);
+}
+
+std::span<const std::byte> decoder_t::decode(const entry_t& entry) {
+  if (!stats.empty()) {
+    return with_byte_order(byte_order, [&](auto order) { return decode_as<counted_t, decltype(order)::value>(entry); });
+  }
+  return with_byte_order(byte_order, [&](auto order) { return decode_as<checked_t, decltype(order)::value>(entry); });
+}
+
+std::span<const std::byte> decoder_t::decode_unchecked(const entry_t& entry) {
+  return with_byte_order(byte_order, [&](auto order) { return decode_as<unchecked_t, decltype(order)::value>(entry); });
+}
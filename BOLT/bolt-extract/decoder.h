@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <span>
+#include <bit>
+
+#include "bolt.h"
+#include "codec.h"
+
+
+namespace BOLT {
+  // Decoding state for one entry at a time. Every worker owns one, they only share the read-only rom.
+  class decoder_t {
+  private:
+    std::span<const std::byte> rom;
+    algorithm_t algorithm = algorithm_t::UNKNOWN;
+    std::endian byte_order = std::endian::little;
+
+    std::size_t bolt_begin = 0;
+    std::size_t cursor_pos = 0;
+    std::size_t input_size = 0;
+
+    std::uint8_t current_filetype = 255;
+
+    // Output storage, grows to the largest entry seen and is reused for every entry after that
+    std::vector<std::byte> buffer;
+
+    decode_error_t error;
+    bool quiet = false;
+
+    // One per algorithm_t once enable_stats() was called, otherwise empty
+    std::vector<codec_stats_t> stats;
+    codec_stats_t* active_stats = nullptr;
+
+    void err_msg(const std::string& msg, std::uint8_t opcode);
+
+    // Runs codec_t over the whole entry in one go, the output buffer is the window
+    template<class codec_t>
+    std::size_t decompress(std::uint32_t offset, std::span<std::byte> out);
+
+    template<class check_t, std::endian order>
+    std::span<const std::byte> decode_as(const entry_t& entry);
+
+    std::size_t decompress_win_special_9(std::uint32_t offset, std::span<std::byte> out);
+    std::size_t decompress_dos_special_8(std::uint32_t offset, std::span<std::byte> out);
+
+  public:
+    // Result stays valid until the next decode call. Every token is bounds checked, a corrupt entry
+    // decodes as far as it can and leaves the reason in last_error().
+    std::span<const std::byte> decode(const entry_t& entry);
+
+    // Same without the bounds checks, only for archives that already decoded cleanly with decode()
+    std::span<const std::byte> decode_unchecked(const entry_t& entry);
+
+    // What went wrong with the last decode, if anything
+    const decode_error_t& last_error() const { return error; }
+
+    // Bytes of the rom the last decode read, all of it for a stored entry
+    std::size_t last_input_size() const { return input_size; }
+
+    // From here on decode() also counts tokens into codec_stats(), which makes it a bit slower
+    void enable_stats();
+    std::span<const codec_stats_t> codec_stats() const { return stats; }
+
+    // Keeps errors out of stderr, they are still in last_error()
+    void set_quiet(bool quiet) { this->quiet = quiet; }
+    bool is_quiet() const { return quiet; }
+
+    // Points the decoder at another archive, the output buffer is kept
+    void bind(std::span<const std::byte> rom, std::size_t bolt_begin, algorithm_t algo, std::endian byte_order);
+
+    decoder_t() = default;
+    decoder_t(std::span<const std::byte> rom, std::size_t bolt_begin, algorithm_t algo, std::endian byte_order);
+  };
+}
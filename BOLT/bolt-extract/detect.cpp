@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <span>
+
+#include "detect.h"
+#include "decoder.h"
+#include "guess_type.h"
+#include "mapped_file.h"
+#include "scan.h"
+#include "thread_pool.h"
+
+
+using namespace BOLT;
+
+namespace {
+  // The usual pairings first, so they win ties
+  constexpr format_score_t CANDIDATES[] = {
+    { algorithm_t::N64, std::endian::big },
+    { algorithm_t::CDI, std::endian::big },
+    { algorithm_t::DOS, std::endian::little },
+    { algorithm_t::WIN, std::endian::little },
+    { algorithm_t::XBOX, std::endian::little },
+    { algorithm_t::N64, std::endian::little },
+    { algorithm_t::CDI, std::endian::little },
+    { algorithm_t::DOS, std::endian::big },
+    { algorithm_t::WIN, std::endian::big },
+    { algorithm_t::XBOX, std::endian::big },
+  };
+
+  constexpr unsigned MAX_TRIALS = 8;
+  constexpr std::size_t MAX_VISITED = 4096;            // entries walked per candidate, the tables may be garbage
+  constexpr std::uint32_t MIN_TRIAL_SIZE = 32;         // tinier entries decode to the right size by accident too often
+  constexpr std::uint32_t MAX_TRIAL_SIZE = 256 * 1024;
+  constexpr std::size_t MAX_PADDING = 16;              // between the end of one entry's data and the next
+
+  struct trial_t {
+    const entry_t* entry;
+    std::size_t bolt_begin;
+    std::uint32_t size;
+    std::size_t room = 0;  // rom bytes up to the next entry's data, 0 if unknown
+  };
+
+  // The smallest compressed entries, walking the folders breadth first. Unlike collect_work every
+  // folder is bounds checked and the walk is capped, a wrong format turns the tables into noise.
+  template<std::endian order>
+  std::vector<trial_t> pick_trials(const bolt_reader_t& reader) {
+    struct table_t {
+      std::size_t begin;
+      std::uint32_t size;
+      std::size_t bolt_begin;
+    };
+
+    std::span<const std::byte> rom = reader.data();
+    std::vector<table_t> tables;
+    for (std::size_t begin : reader.archives()) {
+      const archive_t* header = reinterpret_cast<const archive_t*>(&rom[begin]);
+      tables.push_back({ begin + offsetof(archive_t, entries), reader.get_num_entries(header), begin });
+    }
+
+    std::vector<trial_t> trials;
+    std::vector<std::size_t> data_starts;
+    std::size_t visited = 0;
+    for (std::size_t t = 0; t < tables.size() && visited < MAX_VISITED; ++t) {
+      const table_t table = tables[t];
+      for (std::uint32_t i = 0; i < table.size && visited < MAX_VISITED; ++i, ++visited) {
+        const entry_t& entry = *reinterpret_cast<const entry_t*>(&rom[table.begin + i * sizeof(entry_t)]);
+        std::size_t data = table.bolt_begin + entry.data_offset<order>();
+        if (data >= rom.size()) continue;
+        data_starts.push_back(data);
+
+        if (entry.file_hash<order>() == 0) {
+          std::uint32_t size = reader.get_dir_size(entry);
+          if ((rom.size() - data) / sizeof(entry_t) >= size) tables.push_back({ data, size, table.bolt_begin });
+          continue;
+        }
+
+        std::uint32_t size = entry.uncompressed_size<order>();
+        if ((entry.flags & FLAG_UNCOMPRESSED) || size == 0 || size > MAX_TRIAL_SIZE) continue;
+        trials.push_back({ &entry, table.bolt_begin, size });
+      }
+    }
+
+    std::stable_sort(trials.begin(), trials.end(), [](const trial_t& a, const trial_t& b) {
+      return std::pair(a.size < MIN_TRIAL_SIZE, a.size) < std::pair(b.size < MIN_TRIAL_SIZE, b.size);
+    });
+    if (trials.size() > MAX_TRIALS) trials.resize(MAX_TRIALS);
+
+    // Data is packed in the rom, so the right codec stops reading about where the next entry starts
+    std::sort(data_starts.begin(), data_starts.end());
+    for (trial_t& trial : trials) {
+      std::size_t begin = trial.bolt_begin + trial.entry->data_offset<order>();
+      auto next = std::upper_bound(data_starts.begin(), data_starts.end(), begin);
+      if (next != data_starts.end()) trial.room = *next - begin;
+    }
+    return trials;
+  }
+
+  void try_format(std::span<const std::byte> rom, const std::vector<std::size_t>& magics, format_score_t& candidate) {
+    bolt_reader_t reader{ candidate.algorithm, candidate.byte_order };
+    if (!reader.read_from_memory(rom, magics)) return;
+    candidate.archives = unsigned(reader.archives().size());
+
+    std::vector<trial_t> trials = with_byte_order(candidate.byte_order, [&](auto order) { return pick_trials<decltype(order)::value>(reader); });
+
+    decoder_t decoder;
+    decoder.set_quiet(true);
+    for (const trial_t& trial : trials) {
+      decoder.bind(rom, trial.bolt_begin, candidate.algorithm, candidate.byte_order);
+      std::span<const std::byte> result = decoder.decode(*trial.entry);
+      const decode_error_t& error = decoder.last_error();
+
+      candidate.trials++;
+      if (error.kind == decode_error_kind_t::LOOKBEHIND) {
+        candidate.lookbehind++;
+      }
+      else if (!error && result.size() == trial.size) {
+        candidate.exact++;
+        if (guess_type(result, candidate.byte_order) != file_type_t::UNKNOWN) candidate.typed++;
+
+        std::size_t used = decoder.last_input_size();
+        if (used <= trial.room && trial.room - used < MAX_PADDING) candidate.packed++;
+      }
+    }
+  }
+}
+
+int format_score_t::score() const {
+  if (archives == 0) return 0;
+
+  // Lookbehind errors are the clearest sign of the wrong codec, the other errors also happen with a
+  // corrupt entry
+  int other_errors = int(trials - exact - lookbehind);
+  return 1 + 4 * int(exact) + 4 * int(packed) + 2 * int(typed) - 4 * int(lookbehind) - 2 * other_errors;
+}
+
+std::vector<format_score_t> BOLT::score_formats(const std::filesystem::path& input_file, algorithm_t algorithm, std::optional<std::endian> byte_order) {
+  mapped_file_t file;
+  file.open(input_file);
+  std::span<const std::byte> rom = file.data();
+  std::vector<std::size_t> magics = find_bolt_magics(rom);
+
+  std::vector<format_score_t> scores;
+  for (const format_score_t& candidate : CANDIDATES) {
+    if (algorithm != algorithm_t::UNKNOWN && candidate.algorithm != algorithm) continue;
+    if (byte_order && candidate.byte_order != *byte_order) continue;
+    scores.push_back(candidate);
+  }
+  if (magics.empty()) return scores;
+
+  // Each candidate is a handful of small decodes, the pool is mostly there for big tables
+  thread_pool_t pool{ 0 };
+  std::vector<thread_pool_t::task_t> tasks;
+  for (format_score_t& candidate : scores) {
+    tasks.push_back([&rom, &magics, &candidate](unsigned) { try_format(rom, magics, candidate); });
+  }
+  pool.submit(std::move(tasks));
+  pool.wait();
+
+  std::stable_sort(scores.begin(), scores.end(), [](const format_score_t& a, const format_score_t& b) { return a.score() > b.score(); });
+  return scores;
+}
+
+void BOLT::print_format_scores(std::ostream& out, const std::vector<format_score_t>& scores) {
+  out << std::format("{:<6}{:<8}{:>10}{:>8}{:>8}{:>8}{:>12}{:>8}{:>8}\n", "codec", "order", "archives", "trials", "exact", "packed", "lookbehind", "typed", "score");
+  for (const format_score_t& s : scores) {
+    out << std::format("{:<6}{:<8}{:>10}{:>8}{:>8}{:>8}{:>12}{:>8}{:>8}\n", algorithm_name(s.algorithm), s.byte_order == std::endian::big ? "big" : "little",
+      s.archives, s.trials, s.exact, s.packed, s.lookbehind, s.typed, s.score());
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <vector>
+#include <bit>
+
+#include "bolt.h"
+
+
+namespace BOLT {
+  // How well one algorithm and byte order fit a rom
+  struct format_score_t {
+    algorithm_t algorithm = algorithm_t::UNKNOWN;
+    std::endian byte_order = std::endian::little;
+
+    unsigned archives = 0;    // headers that passed validation with this layout
+    unsigned trials = 0;      // small compressed entries trial decoded
+    unsigned exact = 0;       // decoded without errors to exactly their size
+    unsigned packed = 0;      // exact, and read up to about where the next entry's data starts
+    unsigned lookbehind = 0;  // reached back before the start of the output
+    unsigned typed = 0;       // exact, and guess_type recognised the result
+
+    // 0 without a valid header, above 0 if this could be the format
+    int score() const;
+  };
+
+  // Validates the headers under every algorithm and byte order, then trial decodes a few small
+  // entries with each candidate in parallel. Either can be pinned, best first.
+  std::vector<format_score_t> score_formats(const std::filesystem::path& input_file, algorithm_t algorithm = algorithm_t::UNKNOWN, std::optional<std::endian> byte_order = std::nullopt);
+
+  void print_format_scores(std::ostream& out, const std::vector<format_score_t>& scores);
+}
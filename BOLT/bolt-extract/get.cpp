@@ -0,0 +1,71 @@
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "get.h"
+#include "decoder.h"
+#include "stream_sink.h"
+
+
+using namespace BOLT;
+
+namespace {
+  struct entry_path_t {
+    std::optional<std::size_t> archive;
+    std::vector<unsigned> indices;
+  };
+
+  // Hex parts split by slashes, the last one may still have the extension an extraction gave it
+  entry_path_t parse_entry_path(const std::string& path) {
+    entry_path_t parsed;
+    std::string_view rest = path;
+    while (!rest.empty()) {
+      std::size_t slash = rest.find_first_of("/\\");
+      std::string_view part = rest.substr(0, slash);
+      rest = slash == rest.npos ? std::string_view{} : rest.substr(slash + 1);
+      if (rest.empty()) part = part.substr(0, part.find('.'));
+
+      std::size_t value = 0;
+      auto [end, ec] = std::from_chars(part.data(), part.data() + part.size(), value, 16);
+      bool is_archive = part.size() == 8 && !parsed.archive && parsed.indices.empty();
+      if (part.empty() || ec != std::errc{} || end != part.data() + part.size() || (part.size() > 4 && !is_archive)) {
+        throw std::runtime_error(path + " is not an entry path like 01A/003");
+      }
+
+      if (is_archive) parsed.archive = value;
+      else parsed.indices.push_back(unsigned(value));
+    }
+
+    if (parsed.indices.empty()) {
+      throw std::runtime_error(path + " is not an entry path like 01A/003");
+    }
+    return parsed;
+  }
+}
+
+bool BOLT::get_entry(const std::filesystem::path& input_file, const std::string& path, algorithm_t algorithm, std::endian byte_order, const std::filesystem::path& output) {
+  entry_path_t parsed = parse_entry_path(path);
+
+  bolt_reader_t reader{ algorithm, byte_order };
+  reader.read_one_archive(input_file, parsed.archive);
+  const entry_t& entry = reader.find_entry(parsed.indices);
+
+  decoder_t decoder{ reader.data(), reader.archives().front(), algorithm, byte_order };
+  std::span<const std::byte> result = decoder.decode(entry);
+
+  std::FILE* out = open_output_file(output);
+  if (out == nullptr) {
+    throw std::runtime_error("Can't open " + output.string() + " for writing");
+  }
+  bool written = std::fwrite(result.data(), 1, result.size(), out) == result.size();
+  written = (out == stdout ? std::fflush(out) : std::fclose(out)) == 0 && written;
+  if (!written) {
+    std::cerr << "Can't write " << output.string() << "\n";
+    return false;
+  }
+  return !decoder.last_error();
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <bit>
+
+#include "bolt.h"
+
+
+namespace BOLT {
+  // --get: decodes the one file at path, like 01A/003 in --index, and writes it to output, - for
+  // stdout. A first part of 8 hex digits is the offset of the archive, like the extracted folders
+  // of a rom with several, otherwise it's the first archive. Only that header, the folder tables on
+  // the way and the file's own data are read. False if the file didn't decode cleanly.
+  bool get_entry(const std::filesystem::path& input_file, const std::string& path, algorithm_t algorithm, std::endian byte_order, const std::filesystem::path& output);
+}
@@ -1,201 +1,324 @@
-#include <string>
-#include <array>
-#include <vector>
-#include <cstddef>
-#include <cctype>
-
-#include "guess_type.h"
-#include "util.h"
-
-
-bool check_easy_header(const std::vector<std::byte>& d, char c1, char c2, char c3, char c4) {
-  return d.size() > 32 &&
-    d[0] == std::byte(c1) &&
-    d[1] == std::byte(c2) &&
-    d[2] == std::byte(c3) &&
-    d[3] == std::byte(c4);
-}
-
-bool is_wav_file(const std::vector<std::byte>& data) {
-  return check_easy_header(data, 'R', 'I', 'F', 'F');
-}
-
-bool is_txt_file(const std::vector<std::byte>& data) {
-  for (std::byte b : data) {
-    unsigned char c = static_cast<unsigned char>(b);
-    if (!std::isprint(c) && !std::isspace(c) && c != '' && c != '' && c != '' && c != '') return false;
-  }
-  return true;
-}
-
-struct img_header_t { // big endian header
-  std::uint16_t unk1;
-  std::uint16_t bpp;
-  std::uint32_t unk2;
-  std::uint16_t width;
-  std::uint16_t height;
-  std::uint32_t unk4;
-};
-
-bool is_img_file(const std::vector<std::byte>& data) {
-  if (data.size() <= sizeof(img_header_t)) return false;
-  const img_header_t* tgabw = reinterpret_cast<const img_header_t*>(data.data());
-  
-  std::uint16_t width = ((tgabw->width & 0x00FF) << 8) | ((tgabw->width & 0xFF00) >> 8);
-  std::uint16_t height = ((tgabw->height & 0x00FF) << 8) | ((tgabw->height & 0xFF00) >> 8);
-
-  return 
-    data.size() == width * height + sizeof(img_header_t) && 
-    (tgabw->unk1 & 0xFF) == 0 &&
-    ((tgabw->unk1 & 0xFF00) >> 8) < 5 &&
-    tgabw->bpp == 0x0800 &&
-    tgabw->unk2 == 0 && 
-    tgabw->unk4 == 0;
-}
-
-struct pal_header_t { // big endian header
-  std::uint32_t unk1;  // byte 4 has bpp
-  std::uint16_t entries;
-  std::uint16_t unk2;
-};
-
-bool is_pal_file(const std::vector<std::byte>& data) {
-  if (data.size() <= sizeof(pal_header_t)) return false;
-  const pal_header_t* pal = reinterpret_cast<const pal_header_t*>(data.data());
-
-  return
-    data.size() == 255 * 2 + sizeof(pal_header_t) &&
-    pal->unk1 == 0 &&
-    pal->entries == 0xFF00;
-}
-
-bool is_fnt_file(const std::vector<std::byte>& data) {
-  return check_easy_header(data, 'F', 'O', 'N', 'T');
-}
-
-bool is_chk_file(const std::vector<std::byte>& data) {
-  return
-    check_easy_header(data, 'T', 'Y', 'P', 'E') ||
-    check_easy_header(data, 'V', 'E', 'R', ' ') ||
-    check_easy_header(data, 'I', 'V', 'E', 'R') ||
-    check_easy_header(data, 'I', 'V', 'E', '2') ||
-    check_easy_header(data, 'V', 'C', 'O', 'D');
-}
-
-struct TStrTbl {
-  std::uint16_t wStrCount;
-  std::uint16_t wStrOffsets[1];
-};
-
-bool is_tbl_file(const std::vector<std::byte>& data) {
-  if (data.size() <= sizeof(TStrTbl)) return false;
-  const TStrTbl* pTbl = reinterpret_cast<const TStrTbl*>(data.data());
-  
-  if (pTbl->wStrCount <= 1) return false; // has data
-
-  std::uint32_t data_start = pTbl->wStrCount * 2 + 2;
-  if (data_start >= data.size()) return false; // in bounds
-  if (pTbl->wStrOffsets[0] != data_start) return false; // expected offset
-  
-  for (unsigned i = 0; i < pTbl->wStrCount; i++) {
-    if (pTbl->wStrOffsets[i] < data_start || pTbl->wStrOffsets[i] >= data.size()) return false; // in bounds
-    if (i > 0 && data.at(pTbl->wStrOffsets[i] - 1) != std::byte(0)) return false; // null terminated string
-
-    // must have incremental offsets (not a requirement, but a pattern)
-    if (i > 0 && pTbl->wStrOffsets[i] <= pTbl->wStrOffsets[i - 1]) return false;
-  }
-  return data.back() == std::byte(0); // last null terminated string
-}
-
-struct FRAME {
-  std::uint8_t dx;
-  std::uint8_t dy;
-  std::uint8_t wdt;
-  std::uint8_t hgt;
-  std::uint32_t offset;
-};
-
-#pragma pack(1)
-struct GROUP {
-  std::uint16_t wFrames;
-  std::uint16_t wdt;
-  std::uint16_t hgt;
-  FRAME frames[1];
-};
-#pragma pack()
-
-bool is_grp_file(const std::vector<std::byte>& data) {
-  if (data.size() <= sizeof(GROUP)) return false;
-  const GROUP* pGrp = reinterpret_cast<const GROUP*>(data.data());
-
-  if (pGrp->wFrames == 0 || pGrp->wdt == 0 || pGrp->hgt == 0) return false; // has data
-
-  std::uint32_t data_start = sizeof(GROUP) + (pGrp->wFrames - 1) * sizeof(FRAME);
-  if (data_start + 1 >= data.size()) return false; // in bounds
-  if (pGrp->frames[0].offset != data_start) return false; // expected first offset
-  
-  for (unsigned i = 0; i < pGrp->wFrames; i++) {
-    if (pGrp->frames[i].wdt == 0) return false;
-    if (pGrp->frames[i].hgt == 0) return false;
-
-    if (pGrp->frames[i].dx + pGrp->frames[i].wdt > pGrp->wdt) return false;
-    if (pGrp->frames[i].dy + pGrp->frames[i].hgt > pGrp->hgt) return false;
-
-    if (pGrp->frames[i].offset < data_start || pGrp->frames[i].offset >= data.size()) return false;
-  }
-  return true;
-}
-
-#pragma pack(1)
-struct MASSMEDIA_AUDIO {
-  std::uint8_t channels;
-  std::uint8_t bits;
-  std::uint16_t sampleRate;
-  std::uint32_t dataSize;
-  std::uint32_t dataSize2;
-};
-#pragma pack()
-
-bool is_audio_file(const std::vector<std::byte>& data) {
-  if (data.size() <= sizeof(MASSMEDIA_AUDIO)) return false;
-  const MASSMEDIA_AUDIO* pAudio = reinterpret_cast<const MASSMEDIA_AUDIO*>(data.data());
-
-  if (pAudio->channels > 2) return false;
-  if (pAudio->bits != 4 && pAudio->bits != 8 && pAudio->bits != 16 && pAudio->bits != 24 && pAudio->bits != 32) return false;
-
-  std::uint32_t dataSize = bswap_if(pAudio->dataSize);
-  std::uint32_t dataSize2 = bswap_if(pAudio->dataSize2);
-  if (dataSize != 0 && dataSize2 != 0) return false;  // One of them must contain the size, the other 0
-  if (dataSize2 != 0) dataSize = dataSize2;
-
-  std::uint16_t sampleRate = bswap_if(pAudio->sampleRate);
-
-  if (dataSize + sizeof(MASSMEDIA_AUDIO) != data.size()) return false;
-  if (sampleRate < 8000 || sampleRate > 44100) return false;
-  return true;
-}
-
-bool is_vag_file(const std::vector<std::byte>& data) {
-  return check_easy_header(data, 'V', 'A', 'G', 'p');
-}
-
-bool is_elf_file(const std::vector<std::byte>& data) {
-  return check_easy_header(data, 0x7F, 'E', 'L', 'F');
-}
-
-std::string guess_extension(const std::vector<std::byte>& data) {
-  if (data.size() != 0) {
-    if (is_wav_file(data)) return ".wav";
-    if (is_fnt_file(data)) return ".fnt";
-    if (is_chk_file(data)) return ".chk";
-    if (is_img_file(data)) return ".unkimg";
-    if (is_pal_file(data)) return ".unkpal";
-    if (is_audio_file(data)) return ".unkpcm";
-    if (is_tbl_file(data)) return ".tbl";
-    if (is_grp_file(data)) return ".grp";
-    if (is_txt_file(data)) return ".txt";
-    if (is_vag_file(data)) return ".vag";
-    if (is_elf_file(data)) return ".elf";
-  }
-  return ".unk";
-}
+#include <string>
+#include <array>
+#include <span>
+#include <cstddef>
+#include <cstring>
+#include <bit>
+
+#include "guess_type.h"
+#include "cpu_features.h"
+#include "util.h"
+
+
+namespace {
+  struct magic_t {
+    char bytes[4];
+    file_type_t type;
+  };
+
+  // Files starting with one of these are at least 33 bytes. Their position in file_type_t decides
+  // whether the structural and text checks get to look at the file first.
+  constexpr magic_t MAGICS[] = {
+    { { 'R', 'I', 'F', 'F' }, file_type_t::WAV },
+    { { 'F', 'O', 'N', 'T' }, file_type_t::FNT },
+    { { 'T', 'Y', 'P', 'E' }, file_type_t::CHK },
+    { { 'V', 'E', 'R', ' ' }, file_type_t::CHK },
+    { { 'I', 'V', 'E', 'R' }, file_type_t::CHK },
+    { { 'I', 'V', 'E', '2' }, file_type_t::CHK },
+    { { 'V', 'C', 'O', 'D' }, file_type_t::CHK },
+    { { 'V', 'A', 'G', 'p' }, file_type_t::VAG },
+    { { 0x7F, 'E', 'L', 'F' }, file_type_t::ELF },
+  };
+  static_assert(std::size(MAGICS) <= 16);
+
+  // Bit i is set for the first bytes MAGICS[i] starts with, so a lookup compares at most a couple of them
+  constexpr std::array<std::uint16_t, 256> MAGICS_BY_FIRST_BYTE = [] {
+    std::array<std::uint16_t, 256> table{};
+    for (unsigned i = 0; i < std::size(MAGICS); ++i) {
+      table[static_cast<unsigned char>(MAGICS[i].bytes[0])] |= std::uint16_t(1u << i);
+    }
+    return table;
+  }();
+
+  file_type_t match_magic(std::span<const std::byte> data) {
+    if (data.size() <= 32) return file_type_t::UNKNOWN;
+
+    for (unsigned mask = MAGICS_BY_FIRST_BYTE[std::to_integer<unsigned char>(data[0])]; mask != 0; mask &= mask - 1) {
+      const magic_t& magic = MAGICS[std::countr_zero(mask)];
+      if (std::memcmp(data.data(), magic.bytes, 4) == 0) return magic.type;
+    }
+    return file_type_t::UNKNOWN;
+  }
+
+  // What the C locale's isprint and isspace accept, plus the Windows-1252 curly quotes 0x91-0x94
+  constexpr bool is_text_byte(unsigned char c) {
+    return (c >= 0x20 && c <= 0x7E) || (c >= 0x09 && c <= 0x0D) || (c >= 0x91 && c <= 0x94);
+  }
+
+  constexpr std::array<bool, 256> TEXT_BYTES = [] {
+    std::array<bool, 256> table{};
+    for (unsigned c = 0; c < 256; ++c) {
+      table[c] = is_text_byte(static_cast<unsigned char>(c));
+    }
+    return table;
+  }();
+
+  bool all_text_scalar(const std::byte* data, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+      if (!TEXT_BYTES[std::to_integer<unsigned char>(data[i])]) return false;
+    }
+    return true;
+  }
+
+#ifdef BOLT_X86
+  // Range tests on unsigned bytes with signed compares: shift the range down to start at -128
+  BOLT_TARGET("sse2")
+  __m128i in_range_sse2(__m128i v, char lo, char hi) {
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(char(0x80 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8(char(hi - lo + 1 - 0x80)));
+  }
+
+  BOLT_TARGET("sse2")
+  bool all_text_sse2(const std::byte* data, std::size_t size) {
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      __m128i text = _mm_or_si128(_mm_or_si128(
+        in_range_sse2(v, 0x20, 0x7E),
+        in_range_sse2(v, 0x09, 0x0D)),
+        in_range_sse2(v, char(0x91), char(0x94)));
+      if (_mm_movemask_epi8(text) != 0xFFFF) return false;
+    }
+    return all_text_scalar(data + i, size - i);
+  }
+
+  BOLT_TARGET("avx2")
+  __m256i in_range_avx2(__m256i v, char lo, char hi) {
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8(char(0x80 - lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8(char(hi - lo + 1 - 0x80)), shifted);
+  }
+
+  BOLT_TARGET("avx2")
+  bool all_text_avx2(const std::byte* data, std::size_t size) {
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      __m256i text = _mm256_or_si256(_mm256_or_si256(
+        in_range_avx2(v, 0x20, 0x7E),
+        in_range_avx2(v, 0x09, 0x0D)),
+        in_range_avx2(v, char(0x91), char(0x94)));
+      if (_mm256_movemask_epi8(text) != -1) return false;
+    }
+    return all_text_sse2(data + i, size - i);
+  }
+#endif
+
+  using all_text_fn = bool (*)(const std::byte* data, std::size_t size);
+
+  all_text_fn select_text_kernel() {
+#ifdef BOLT_X86
+    if (BOLT::cpu_has_avx2()) return all_text_avx2;
+    if (BOLT::cpu_has_sse2()) return all_text_sse2;
+#endif
+    return all_text_scalar;
+  }
+
+  const all_text_fn all_text = select_text_kernel();
+}
+
+bool is_txt_file(std::span<const std::byte> data) {
+  return all_text(data.data(), data.size());
+}
+
+struct img_header_t { // big endian header
+  std::uint16_t unk1;
+  std::uint16_t bpp;
+  std::uint32_t unk2;
+  std::uint16_t width;
+  std::uint16_t height;
+  std::uint32_t unk4;
+};
+
+bool is_img_file(std::span<const std::byte> data) {
+  if (data.size() <= sizeof(img_header_t)) return false;
+  const img_header_t* tgabw = reinterpret_cast<const img_header_t*>(data.data());
+  
+  std::uint16_t width = ((tgabw->width & 0x00FF) << 8) | ((tgabw->width & 0xFF00) >> 8);
+  std::uint16_t height = ((tgabw->height & 0x00FF) << 8) | ((tgabw->height & 0xFF00) >> 8);
+
+  return 
+    data.size() == std::size_t(width) * height + sizeof(img_header_t) && 
+    (tgabw->unk1 & 0xFF) == 0 &&
+    ((tgabw->unk1 & 0xFF00) >> 8) < 5 &&
+    tgabw->bpp == 0x0800 &&
+    tgabw->unk2 == 0 && 
+    tgabw->unk4 == 0;
+}
+
+struct pal_header_t { // big endian header
+  std::uint32_t unk1;  // byte 4 has bpp
+  std::uint16_t entries;
+  std::uint16_t unk2;
+};
+
+bool is_pal_file(std::span<const std::byte> data) {
+  if (data.size() <= sizeof(pal_header_t)) return false;
+  const pal_header_t* pal = reinterpret_cast<const pal_header_t*>(data.data());
+
+  return
+    data.size() == 255 * 2 + sizeof(pal_header_t) &&
+    pal->unk1 == 0 &&
+    pal->entries == 0xFF00;
+}
+
+struct TStrTbl {
+  std::uint16_t wStrCount;
+  std::uint16_t wStrOffsets[1];
+};
+
+bool is_tbl_file(std::span<const std::byte> data) {
+  if (data.size() <= sizeof(TStrTbl)) return false;
+  const TStrTbl* pTbl = reinterpret_cast<const TStrTbl*>(data.data());
+  
+  if (pTbl->wStrCount <= 1) return false; // has data
+
+  std::uint32_t data_start = pTbl->wStrCount * 2 + 2;
+  if (data_start >= data.size()) return false; // in bounds
+  if (pTbl->wStrOffsets[0] != data_start) return false; // expected offset
+  
+  for (unsigned i = 0; i < pTbl->wStrCount; i++) {
+    if (pTbl->wStrOffsets[i] < data_start || pTbl->wStrOffsets[i] >= data.size()) return false; // in bounds
+    if (i > 0 && data[pTbl->wStrOffsets[i] - 1] != std::byte(0)) return false; // null terminated string
+
+    // must have incremental offsets (not a requirement, but a pattern)
+    if (i > 0 && pTbl->wStrOffsets[i] <= pTbl->wStrOffsets[i - 1]) return false;
+  }
+  return data.back() == std::byte(0); // last null terminated string
+}
+
+struct FRAME {
+  std::uint8_t dx;
+  std::uint8_t dy;
+  std::uint8_t wdt;
+  std::uint8_t hgt;
+  std::uint32_t offset;
+};
+
+#pragma pack(1)
+struct GROUP {
+  std::uint16_t wFrames;
+  std::uint16_t wdt;
+  std::uint16_t hgt;
+  FRAME frames[1];
+};
+#pragma pack()
+
+bool is_grp_file(std::span<const std::byte> data) {
+  if (data.size() <= sizeof(GROUP)) return false;
+  const GROUP* pGrp = reinterpret_cast<const GROUP*>(data.data());
+
+  if (pGrp->wFrames == 0 || pGrp->wdt == 0 || pGrp->hgt == 0) return false; // has data
+
+  std::uint32_t data_start = sizeof(GROUP) + (pGrp->wFrames - 1) * sizeof(FRAME);
+  if (data_start + 1 >= data.size()) return false; // in bounds
+  if (pGrp->frames[0].offset != data_start) return false; // expected first offset
+  
+  for (unsigned i = 0; i < pGrp->wFrames; i++) {
+    if (pGrp->frames[i].wdt == 0) return false;
+    if (pGrp->frames[i].hgt == 0) return false;
+
+    if (pGrp->frames[i].dx + pGrp->frames[i].wdt > pGrp->wdt) return false;
+    if (pGrp->frames[i].dy + pGrp->frames[i].hgt > pGrp->hgt) return false;
+
+    if (pGrp->frames[i].offset < data_start || pGrp->frames[i].offset >= data.size()) return false;
+  }
+  return true;
+}
+
+#pragma pack(1)
+struct MASSMEDIA_AUDIO {
+  std::uint8_t channels;
+  std::uint8_t bits;
+  std::uint16_t sampleRate;
+  std::uint32_t dataSize;
+  std::uint32_t dataSize2;
+};
+#pragma pack()
+
+template<std::endian order>
+bool is_audio_file(std::span<const std::byte> data) {
+  if (data.size() <= sizeof(MASSMEDIA_AUDIO)) return false;
+  const MASSMEDIA_AUDIO* pAudio = reinterpret_cast<const MASSMEDIA_AUDIO*>(data.data());
+
+  if (pAudio->channels > 2) return false;
+  if (pAudio->bits != 4 && pAudio->bits != 8 && pAudio->bits != 16 && pAudio->bits != 24 && pAudio->bits != 32) return false;
+
+  std::uint32_t dataSize = from_endian<order>(pAudio->dataSize);
+  std::uint32_t dataSize2 = from_endian<order>(pAudio->dataSize2);
+  if (dataSize != 0 && dataSize2 != 0) return false;  // One of them must contain the size, the other 0
+  if (dataSize2 != 0) dataSize = dataSize2;
+
+  std::uint16_t sampleRate = from_endian<order>(pAudio->sampleRate);
+
+  if (dataSize + sizeof(MASSMEDIA_AUDIO) != data.size()) return false;
+  if (sampleRate < 8000 || sampleRate > 44100) return false;
+  return true;
+}
+
+file_type_t guess_type(std::span<const std::byte> data, std::endian order) {
+  if (data.size() == 0) return file_type_t::UNKNOWN;
+
+  // The magic numbers that come first in file_type_t win outright
+  file_type_t magic = match_magic(data);
+  if (magic != file_type_t::UNKNOWN && magic < file_type_t::IMG) return magic;
+
+  // These three need a zero, or a channel count of at most 2, in the first byte, no magic has that
+  if (std::to_integer<unsigned char>(data[0]) <= 2) {
+    if (is_img_file(data)) return file_type_t::IMG;
+    if (is_pal_file(data)) return file_type_t::PAL;
+    if (with_byte_order(order, [&](auto known) { return is_audio_file<decltype(known)::value>(data); })) return file_type_t::AUDIO;
+  }
+
+  if (is_tbl_file(data)) return file_type_t::TBL;
+  if (is_grp_file(data)) return file_type_t::GRP;
+  if (TEXT_BYTES[std::to_integer<unsigned char>(data[0])] && is_txt_file(data)) return file_type_t::TXT;
+  return magic;
+}
+
+const char* type_extension(file_type_t type) {
+  switch (type) {
+  case file_type_t::WAV: return ".wav";
+  case file_type_t::FNT: return ".fnt";
+  case file_type_t::CHK: return ".chk";
+  case file_type_t::IMG: return ".unkimg";
+  case file_type_t::PAL: return ".unkpal";
+  case file_type_t::AUDIO: return ".unkpcm";
+  case file_type_t::TBL: return ".tbl";
+  case file_type_t::GRP: return ".grp";
+  case file_type_t::TXT: return ".txt";
+  case file_type_t::VAG: return ".vag";
+  case file_type_t::ELF: return ".elf";
+  default: return ".unk";
+  }
+}
+
+const char* type_detector(file_type_t type) {
+  switch (type) {
+  case file_type_t::WAV: return "RIFF magic";
+  case file_type_t::FNT: return "FONT magic";
+  case file_type_t::CHK: return "chunk magic";
+  case file_type_t::IMG: return "image header";
+  case file_type_t::PAL: return "palette header";
+  case file_type_t::AUDIO: return "audio header";
+  case file_type_t::TBL: return "string table";
+  case file_type_t::GRP: return "frame group";
+  case file_type_t::TXT: return "text";
+  case file_type_t::VAG: return "VAGp magic";
+  case file_type_t::ELF: return "ELF magic";
+  default: return "none";
+  }
+}
+
+std::string guess_extension(std::span<const std::byte> data, std::endian order) {
+  return type_extension(guess_type(data, order));
+}
@@ -1,6 +1,31 @@
-#pragma once
-#include <string>
-#include <vector>
-#include <cstddef>
-
-std::string guess_extension(const std::vector<std::byte>& data);
+#pragma once
+#include <string>
+#include <span>
+#include <cstddef>
+#include <bit>
+
+// Everything the file type sniffing can recognise. When several match, the earlier one wins.
+enum class file_type_t {
+  UNKNOWN,
+  WAV,
+  FNT,
+  CHK,
+  IMG,
+  PAL,
+  AUDIO,
+  TBL,
+  GRP,
+  TXT,
+  VAG,
+  ELF,
+};
+
+// One pass: a lookup on the first bytes, then only the structural checks that can still match
+file_type_t guess_type(std::span<const std::byte> data, std::endian order);
+
+const char* type_extension(file_type_t type);
+
+// Which check recognised the file, for reporting
+const char* type_detector(file_type_t type);
+
+std::string guess_extension(std::span<const std::byte> data, std::endian order);
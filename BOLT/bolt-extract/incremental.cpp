@@ -0,0 +1,151 @@
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <system_error>
+
+#include "incremental.h"
+#include "util.h"
+
+
+using namespace BOLT;
+
+namespace {
+  constexpr const char* STATE_HEADER = "bolt-extract state 1";
+
+  std::string to_hex(std::span<const std::byte> bytes) {
+    static constexpr char digits[] = "0123456789ABCDEF";
+    std::string result;
+    for (std::byte b : bytes) {
+      result += digits[std::to_integer<unsigned>(b) >> 4];
+      result += digits[std::to_integer<unsigned>(b) & 15];
+    }
+    return result;
+  }
+
+  bool from_hex(std::string_view hex, std::span<std::byte> bytes) {
+    if (hex.size() != bytes.size() * 2) return false;
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+      unsigned value = 0;
+      auto [end, ec] = std::from_chars(hex.data() + i * 2, hex.data() + i * 2 + 2, value, 16);
+      if (ec != std::errc() || end != hex.data() + i * 2 + 2) return false;
+      bytes[i] = std::byte(value);
+    }
+    return true;
+  }
+
+  std::string_view next_field(std::string_view& line) {
+    std::size_t end = line.find('\t');
+    std::string_view field = line.substr(0, end);
+    line.remove_prefix(end == std::string_view::npos ? line.size() : end + 1);
+    return field;
+  }
+
+  template<class T>
+  bool parse_number(std::string_view field, T& value, int base = 10) {
+    auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), value, base);
+    return ec == std::errc() && end == field.data() + field.size();
+  }
+
+  // Key, entry bytes, input size, input hash, type, file size, mtime and filename, separated by tabs
+  bool parse_line(std::string_view line, std::string& key, extracted_file_t& file) {
+    unsigned type = 0;
+    key = next_field(line);
+    if (!from_hex(next_field(line), file.fingerprint.entry)) return false;
+    if (!parse_number(next_field(line), file.fingerprint.input_size)) return false;
+    if (!parse_number(next_field(line), file.fingerprint.input_hash, 16)) return false;
+    if (!parse_number(next_field(line), type)) return false;
+    if (!parse_number(next_field(line), file.stamp.size)) return false;
+    if (!parse_number(next_field(line), file.stamp.mtime)) return false;
+
+    file.filename = line;
+    file.type = static_cast<file_type_t>(type);
+    return !key.empty() && !file.filename.empty();
+  }
+
+  std::int64_t to_ticks(std::filesystem::file_time_type time) {
+    return static_cast<std::int64_t>(time.time_since_epoch().count());
+  }
+}
+
+void extract_state_t::load(const std::filesystem::path& output_dir) {
+  std::ifstream in(output_dir / FILE_NAME, std::ios::binary);
+  std::string line;
+  if (!std::getline(in, line) || line != STATE_HEADER) return;
+
+  while (std::getline(in, line)) {
+    std::string key;
+    extracted_file_t file;
+    if (parse_line(line, key, file)) {
+      files.insert_or_assign(std::move(key), std::move(file));
+    }
+  }
+}
+
+bool extract_state_t::save(const std::filesystem::path& output_dir) const {
+  // Written next to the old one and renamed over it, so an interrupted run can't leave half a state
+  std::filesystem::path state_path = output_dir / FILE_NAME;
+  std::filesystem::path temp_path = state_path;
+  temp_path += ".tmp";
+
+  {
+    std::ofstream out(temp_path, std::ios::binary);
+    out << STATE_HEADER << "\n";
+    for (const auto& [key, file] : files) {
+      out << key << "\t" << to_hex(file.fingerprint.entry)
+        << std::format("\t{}\t{:016X}\t{}\t{}\t{}\t", file.fingerprint.input_size, file.fingerprint.input_hash, unsigned(file.type), file.stamp.size, file.stamp.mtime)
+        << file.filename << "\n";
+    }
+    if (!out.flush()) return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(temp_path, state_path, ec);
+  return !ec;
+}
+
+const extracted_file_t* extract_state_t::find(const std::string& key) const {
+  auto it = files.find(key);
+  return it == files.end() ? nullptr : &it->second;
+}
+
+void extract_state_t::set(const std::string& key, extracted_file_t file) {
+  files.insert_or_assign(key, std::move(file));
+}
+
+std::optional<entry_fingerprint_t> BOLT::fingerprint_entry(std::span<const std::byte> rom, std::size_t bolt_begin, const entry_t& entry, std::endian order, std::size_t input_size) {
+  std::size_t begin = bolt_begin + entry.data_offset(order);
+  if (begin > rom.size() || input_size > rom.size() - begin) return std::nullopt;
+
+  entry_fingerprint_t result;
+  std::memcpy(result.entry.data(), &entry, sizeof(entry_t));
+  result.input_size = input_size;
+  result.input_hash = fnv1a_64(rom.subspan(begin, input_size));
+  return result;
+}
+
+std::unordered_map<std::string, file_stamp_t> BOLT::stamp_output_files(const std::filesystem::path& output_dir) {
+  std::unordered_map<std::string, file_stamp_t> stamps;
+  std::error_code ec;
+  for (auto it = std::filesystem::recursive_directory_iterator(output_dir, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+    if (!it->is_regular_file(ec)) continue;
+
+    file_stamp_t stamp{ it->file_size(ec), to_ticks(it->last_write_time(ec)) };
+    if (!ec) {
+      stamps.emplace(it->path().lexically_relative(output_dir).generic_string(), stamp);
+    }
+  }
+  return stamps;
+}
+
+std::optional<file_stamp_t> BOLT::stamp_file(const std::filesystem::path& filename) {
+  std::error_code ec;
+  file_stamp_t stamp{ std::filesystem::file_size(filename, ec) };
+  if (ec) return std::nullopt;
+
+  stamp.mtime = to_ticks(std::filesystem::last_write_time(filename, ec));
+  if (ec) return std::nullopt;
+  return stamp;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <bit>
+
+#include "bolt.h"
+#include "guess_type.h"
+
+
+namespace BOLT {
+  // Whether an entry still decodes to what it did: the raw entry_t, and a hash of the rom bytes the
+  // decoder read for it
+  struct entry_fingerprint_t {
+    std::array<std::byte, sizeof(entry_t)> entry;
+    std::uint64_t input_size;
+    std::uint64_t input_hash;
+
+    bool operator==(const entry_fingerprint_t&) const = default;
+  };
+
+  struct file_stamp_t {
+    std::uintmax_t size = 0;
+    std::int64_t mtime = 0;  // in the file clock's own ticks
+
+    bool operator==(const file_stamp_t&) const = default;
+  };
+
+  // What an earlier run wrote for one entry, and the stamp the file had right after
+  struct extracted_file_t {
+    entry_fingerprint_t fingerprint;
+    std::string filename;  // generic, relative to the output directory
+    file_type_t type;
+    file_stamp_t stamp;
+  };
+
+  // Kept in each output directory between --incremental runs, keyed by entry path like 01A/003
+  class extract_state_t {
+  private:
+    std::unordered_map<std::string, extracted_file_t> files;
+
+  public:
+    static constexpr const char* FILE_NAME = ".bolt-extract.state";
+
+    // A missing or unreadable state just means everything gets extracted
+    void load(const std::filesystem::path& output_dir);
+    bool save(const std::filesystem::path& output_dir) const;
+
+    const extracted_file_t* find(const std::string& key) const;
+    void set(const std::string& key, extracted_file_t file);
+  };
+
+  // Empty if input_size bytes from the entry's data run past the end of the rom
+  std::optional<entry_fingerprint_t> fingerprint_entry(std::span<const std::byte> rom, std::size_t bolt_begin, const entry_t& entry, std::endian order, std::size_t input_size);
+
+  // Every file under output_dir by generic relative path. One directory walk, which on Windows
+  // comes with the size and time of each file instead of a call per file.
+  std::unordered_map<std::string, file_stamp_t> stamp_output_files(const std::filesystem::path& output_dir);
+
+  std::optional<file_stamp_t> stamp_file(const std::filesystem::path& filename);
+}
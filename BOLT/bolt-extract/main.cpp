@@ -1,102 +1,502 @@
-#include <string>
-#include <iostream>
-#include <filesystem>
-
-#include "../cxxopts/include/cxxopts.hpp"
-
-#include "bolt.h"
-#include "util.h"
-
-
-// Configure the command line
-void configure(cxxopts::Options& cmd) {
-  cmd.add_options()
-    ("i,input", "input file", cxxopts::value<std::string>())
-    ("b,big", "Use Big Endian byte order (N64, CD-i)")
-    ("a,algo", "Choose algorithm to use.", cxxopts::value<std::string>()->default_value(""), "cdi|dos|n64|gba|win|xbox|ps2")
-    ("o,output", "output directory (optional, defaults to input file's directory)", cxxopts::value<std::string>())
-    ("h,help", "show help")
-    ;
-
-  cmd.parse_positional({ "input", "output" });
-  cmd.positional_help("INPUT_FILE [OUTPUT_DIR]");
-  cmd.allow_unrecognised_options();
-}
-
-void show_help(cxxopts::Options &cmd) {
-  std::cerr << cmd.help() << std::endl;
-}
-
-void check_debugger() {
-#ifdef _DEBUG
-  std::cerr << "Attach debugger, then press enter..." << std::endl;
-  std::cin.ignore();
-#endif
-}
-
-
-std::map<std::string, BOLT::algorithm_t> algorithm_mappings = {
-  {"cdi", BOLT::algorithm_t::CDI},
-  {"dos", BOLT::algorithm_t::DOS},
-  {"msdos", BOLT::algorithm_t::DOS},
-  {"n64", BOLT::algorithm_t::N64},
-  {"gba", BOLT::algorithm_t::N64},
-  {"z64", BOLT::algorithm_t::N64},
-  {"win", BOLT::algorithm_t::WIN},
-  {"windows", BOLT::algorithm_t::WIN},
-  {"xbox", BOLT::algorithm_t::XBOX},
-  {"ps2", BOLT::algorithm_t::XBOX},
-};
-
-BOLT::algorithm_t determine_algorithm(const std::filesystem::path &input_file, std::string algorithm) {
-  if (algorithm.empty()) {
-    algorithm = input_file.extension().string();
-    algorithm.erase(0, 1);
-  }
-
-  if (algorithm_mappings.contains(algorithm)) {
-    return algorithm_mappings.at(algorithm);
-  }
-  return BOLT::algorithm_t::UNKNOWN;
-}
-
-int main(int argc, const char **argv)
-{
-  cxxopts::Options cmd("bolt-extract", "Extract Mass Media's BOLT archive from binaries.");
-  configure(cmd);
-
-  auto parsed = cmd.parse(argc, argv);
-  
-  if (parsed.count("help")) {
-    show_help(cmd);
-    return 0;
-  }
-
-  if (!parsed.count("input")) {
-    std::cerr << "Missing input file.\n";
-    show_help(cmd);
-    return 1;
-  }
-
-  std::string input_file = parsed["input"].as<std::string>();
-  std::filesystem::path input_path = std::filesystem::absolute(input_file);
-
-  std::filesystem::path output_path = input_path.parent_path() / input_path.stem();
-  if (parsed.count("output")) {
-    output_path = std::filesystem::absolute(parsed["output"].as<std::string>());
-  }
-  
-  BOLT::g_big_endian = parsed["big"].as<bool>();
-
-  check_debugger();
-
-  BOLT::algorithm_t algorithm = determine_algorithm(input_path, parsed["algo"].as<std::string>());
-  if (algorithm == BOLT::algorithm_t::UNKNOWN) {
-    std::cerr << "Please choose a supported algorithm.\n";
-    show_help(cmd);
-    return 1;
-  }
-
-  BOLT::extract_bolt(input_path, output_path, algorithm);
-  return 0;
-}
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <optional>
+
+#include "../cxxopts/include/cxxopts.hpp"
+
+#include "bolt.h"
+#include "bench.h"
+#include "detect.h"
+#include "get.h"
+#include "manifest.h"
+#include "repack.h"
+#include "stats.h"
+#include "stream_sink.h"
+#include "util.h"
+#include "verify.h"
+
+
+// Configure the command line
+void configure(cxxopts::Options& cmd) {
+  cmd.add_options()
+    ("i,input", "input file", cxxopts::value<std::string>())
+    ("b,big", "Use Big Endian byte order (N64, CD-i), same as --endian big")
+    ("endian", "Byte order of the archive tables, auto detects it", cxxopts::value<std::string>()->default_value("auto"), "auto|little|big")
+    ("a,algo", "Choose algorithm to use, auto or an unknown extension tries them all", cxxopts::value<std::string>()->default_value(""), "auto|cdi|dos|n64|gba|win|xbox|ps2")
+    ("o,output", "output directory (optional, defaults to input file's directory)", cxxopts::value<std::string>())
+    ("j,jobs", "Number of entries to extract in parallel, 0 for one per core.", cxxopts::value<unsigned>()->default_value("1"), "N")
+    ("l,list", "Extract every rom in a directory, or every rom named in a list file", cxxopts::value<std::string>(), "DIR|FILE")
+    ("tar", "Write everything as one tar stream instead of loose files, - for stdout", cxxopts::value<std::string>(), "FILE")
+    ("cpio", "Same as --tar, in cpio's newc format", cxxopts::value<std::string>(), "FILE")
+    ("detect", "Print how well every algorithm and byte order fit INPUT_FILE, without extracting")
+    ("index", "Print every entry's header fields to stdout without decoding anything")
+    ("get", "Decode only the file at PATH, like 01A/003, to -o FILE or stdout without reading the rest of the rom", cxxopts::value<std::string>(), "PATH")
+    ("manifest", "Also write the header fields, guessed type and decode time of every extracted file to FILE", cxxopts::value<std::string>(), "FILE")
+    ("format", "Format for --index and --manifest", cxxopts::value<std::string>()->default_value("json"), "json|csv")
+    ("verify", "Decode everything without writing anything, list every file that fails and print the throughput")
+    ("incremental", "Only extract entries that changed since the last --incremental run into the same directory")
+    ("stats", "Print decode statistics to stderr: sizes, ratios, token counts and match lengths per codec")
+    ("stats-json", "Also write the statistics, with every decoded file, to FILE as JSON", cxxopts::value<std::string>(), "FILE")
+    ("dedupe", "Hardlink files whose content was already written, or only report them", cxxopts::value<std::string>(), "link|report")
+    ("repack", "Build an archive from an extracted folder, INPUT is the folder and OUTPUT the archive")
+    ("level", "Compression level for --repack, 0 stores, 1 is fastest, 9 smallest", cxxopts::value<int>()->default_value(std::to_string(BOLT::DEFAULT_REPACK_LEVEL)), "N")
+    ("bench", "Benchmark the decoders on a synthetic corpus, or on INPUT_FILE if given")
+    ("bench-size", "Uncompressed size of each synthetic archive", cxxopts::value<unsigned>()->default_value("16"), "MiB")
+    ("bench-reps", "Timed runs per benchmark, the median is reported", cxxopts::value<unsigned>()->default_value("5"), "N")
+    ("h,help", "show help")
+    ;
+
+  cmd.parse_positional({ "input", "output" });
+  cmd.positional_help("INPUT_FILE [OUTPUT_DIR]");
+  cmd.allow_unrecognised_options();
+}
+
+void show_help(cxxopts::Options &cmd) {
+  std::cerr << cmd.help() << std::endl;
+}
+
+void check_debugger() {
+#ifdef _DEBUG
+  std::cerr << "Attach debugger, then press enter..." << std::endl;
+  std::cin.ignore();
+#endif
+}
+
+
+std::map<std::string, BOLT::algorithm_t> algorithm_mappings = {
+  {"cdi", BOLT::algorithm_t::CDI},
+  {"dos", BOLT::algorithm_t::DOS},
+  {"msdos", BOLT::algorithm_t::DOS},
+  {"n64", BOLT::algorithm_t::N64},
+  {"gba", BOLT::algorithm_t::N64},
+  {"z64", BOLT::algorithm_t::N64},
+  {"win", BOLT::algorithm_t::WIN},
+  {"windows", BOLT::algorithm_t::WIN},
+  {"xbox", BOLT::algorithm_t::XBOX},
+  {"ps2", BOLT::algorithm_t::XBOX},
+};
+
+BOLT::algorithm_t determine_algorithm(const std::filesystem::path &input_file, std::string algorithm) {
+  if (algorithm.empty()) {
+    algorithm = input_file.extension().string();
+    algorithm.erase(0, 1);
+  }
+
+  if (algorithm_mappings.contains(algorithm)) {
+    return algorithm_mappings.at(algorithm);
+  }
+  return BOLT::algorithm_t::UNKNOWN;
+}
+
+// Used for roms in a --list directory, where there's no way to pass -b per file
+std::endian platform_byte_order(const std::filesystem::path& input_file, std::string algorithm) {
+  if (algorithm.empty()) {
+    algorithm = input_file.extension().string();
+    algorithm.erase(0, 1);
+  }
+
+  if (algorithm == "n64" || algorithm == "z64" || algorithm == "cdi") return std::endian::big;
+  return std::endian::little;
+}
+
+// --endian, with -b short for --endian big. Empty for auto, which leaves it to detection.
+std::optional<std::endian> chosen_byte_order(const std::string& endian, bool big) {
+  if (big || endian == "big") return std::endian::big;
+  if (endian == "little") return std::endian::little;
+  return std::nullopt;
+}
+
+std::optional<std::endian> chosen_byte_order(const cxxopts::ParseResult& parsed) {
+  return chosen_byte_order(parsed["endian"].as<std::string>(), parsed["big"].as<bool>());
+}
+
+// Whatever -a and the byte order leave open is decided by trial decoding the rom, falling back on the
+// extension for the byte order. False if there's still no algorithm.
+bool resolve_format(const std::filesystem::path& input_file, const std::string& algo, std::optional<std::endian> chosen_order, BOLT::algorithm_t& algorithm, std::endian& byte_order) {
+  algorithm = determine_algorithm(input_file, algo);
+  byte_order = chosen_order.value_or(platform_byte_order(input_file, algo));
+  if (algorithm != BOLT::algorithm_t::UNKNOWN && chosen_order) return true;
+
+  std::vector<BOLT::format_score_t> scores;
+  try {
+    scores = BOLT::score_formats(input_file, algorithm, chosen_order);
+  }
+  catch (const std::exception&) {
+    // Left to the extraction to report
+  }
+  if (scores.empty() || scores.front().score() <= 0) return algorithm != BOLT::algorithm_t::UNKNOWN;
+
+  const BOLT::format_score_t& best = scores.front();
+  if (best.algorithm != algorithm || best.byte_order != byte_order) {
+    std::ostringstream ss;
+    ss << input_file.filename().string() << ": detected " << BOLT::algorithm_name(best.algorithm) << ", " << (best.byte_order == std::endian::big ? "big" : "little") << " endian\n";
+    std::cerr << ss.str();
+  }
+  algorithm = best.algorithm;
+  byte_order = best.byte_order;
+  return true;
+}
+
+// Splits on whitespace, "double quotes" keep paths with spaces together
+std::vector<std::string> split_list_line(const std::string& line) {
+  std::vector<std::string> tokens;
+  std::istringstream ss(line);
+  std::string token;
+  while (ss >> std::ws && !ss.eof()) {
+    if (ss.peek() == '"') {
+      ss.get();
+      std::getline(ss, token, '"');
+    }
+    else {
+      ss >> token;
+    }
+    tokens.push_back(token);
+  }
+  return tokens;
+}
+
+// Each line of a list file is [-a ALGO] [-b | --endian ORDER] [-o OUTPUT_DIR] INPUT_FILE, relative paths are relative to the list file.
+// Blank lines and lines starting with # are skipped.
+bool read_list_file(const std::filesystem::path& list_file, const cxxopts::ParseResult& parsed, const std::filesystem::path& output_root, std::vector<BOLT::batch_input_t>& inputs) {
+  std::ifstream in(list_file);
+  if (!in) {
+    std::cerr << "Failed to open " << list_file.string() << "\n";
+    return false;
+  }
+
+  std::filesystem::path base_dir = list_file.parent_path();
+  std::string line;
+  for (unsigned line_num = 1; std::getline(in, line); ++line_num) {
+    std::vector<std::string> tokens = split_list_line(line);
+    if (tokens.empty() || tokens[0][0] == '#') continue;
+
+    std::string algo = parsed["algo"].as<std::string>();
+    std::optional<std::endian> chosen_order = chosen_byte_order(parsed);
+    std::string endian;
+    std::string output;
+    std::string input;
+
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+      if (tokens[i] == "-b") chosen_order = std::endian::big;
+      else if (tokens[i] == "--endian" && i + 1 < tokens.size()) endian = tokens[++i];
+      else if (tokens[i] == "-a" && i + 1 < tokens.size()) algo = tokens[++i];
+      else if (tokens[i] == "-o" && i + 1 < tokens.size()) output = tokens[++i];
+      else input = tokens[i];
+    }
+
+    if (input.empty()) {
+      std::cerr << list_file.string() << ":" << line_num << ": missing input file\n";
+      return false;
+    }
+    if (!endian.empty()) {
+      if (endian != "auto" && endian != "little" && endian != "big") {
+        std::cerr << list_file.string() << ":" << line_num << ": unknown byte order " << endian << "\n";
+        return false;
+      }
+      chosen_order = chosen_byte_order(endian, false);
+    }
+
+    std::filesystem::path input_path = std::filesystem::absolute(base_dir / input).lexically_normal();
+    std::filesystem::path output_path = output.empty() ? output_root / input_path.stem() : std::filesystem::absolute(base_dir / output).lexically_normal();
+
+    BOLT::algorithm_t algorithm;
+    std::endian order;
+    if (!resolve_format(input_path, algo, chosen_order, algorithm, order)) {
+      std::cerr << list_file.string() << ":" << line_num << ": please choose a supported algorithm\n";
+      return false;
+    }
+    inputs.push_back({ input_path, output_path, algorithm, order });
+  }
+  return true;
+}
+
+// Every file in the directory with a recognised extension, or all of them if -a is given. With -a auto
+// only the ones some algorithm fits.
+void read_list_dir(const std::filesystem::path& dir, const cxxopts::ParseResult& parsed, const std::filesystem::path& output_root, std::vector<BOLT::batch_input_t>& inputs) {
+  std::string algo = parsed["algo"].as<std::string>();
+
+  std::vector<std::filesystem::path> files;
+  for (const auto& file : std::filesystem::directory_iterator(dir)) {
+    if (file.is_regular_file()) files.push_back(file.path());
+  }
+  std::sort(files.begin(), files.end());
+
+  for (const std::filesystem::path& input_path : files) {
+    if (algo != "auto" && determine_algorithm(input_path, algo) == BOLT::algorithm_t::UNKNOWN) continue;
+
+    BOLT::algorithm_t algorithm;
+    std::endian order;
+    if (!resolve_format(input_path, algo, chosen_byte_order(parsed), algorithm, order)) continue;
+    inputs.push_back({ input_path, output_root / input_path.stem(), algorithm, order });
+  }
+}
+
+// --tar and --cpio put the whole tree in one stream, with names relative to root. Null means loose files.
+std::unique_ptr<BOLT::output_sink_t> open_sink(const cxxopts::ParseResult& parsed, const std::filesystem::path& root) {
+  if (parsed.count("tar")) {
+    return BOLT::open_stream_sink(BOLT::stream_format_t::TAR, parsed["tar"].as<std::string>(), root);
+  }
+  if (parsed.count("cpio")) {
+    return BOLT::open_stream_sink(BOLT::stream_format_t::CPIO, parsed["cpio"].as<std::string>(), root);
+  }
+  return nullptr;
+}
+
+std::optional<BOLT::manifest_format_t> manifest_format(const cxxopts::ParseResult& parsed) {
+  std::string format = parsed["format"].as<std::string>();
+  if (format == "json") return BOLT::manifest_format_t::JSON;
+  if (format == "csv") return BOLT::manifest_format_t::CSV;
+  return std::nullopt;
+}
+
+std::optional<BOLT::dedupe_mode_t> dedupe_mode(const cxxopts::ParseResult& parsed) {
+  if (!parsed.count("dedupe")) return BOLT::dedupe_mode_t::NONE;
+
+  std::string mode = parsed["dedupe"].as<std::string>();
+  if (mode == "link") return BOLT::dedupe_mode_t::LINK;
+  if (mode == "report") return BOLT::dedupe_mode_t::REPORT;
+  return std::nullopt;
+}
+
+// Output goes under root, manifest and stats are filled in if --manifest and --stats are given
+BOLT::extract_options_t extract_options(const cxxopts::ParseResult& parsed, const std::filesystem::path& root, std::vector<BOLT::manifest_entry_t>& manifest, BOLT::decode_stats_t& stats) {
+  BOLT::extract_options_t options;
+  options.jobs = parsed["jobs"].as<unsigned>();
+  options.sink = open_sink(parsed, root);
+  options.manifest = parsed.count("manifest") ? &manifest : nullptr;
+  options.dedupe = *dedupe_mode(parsed);
+  options.incremental = parsed.count("incremental") != 0;
+  options.stats = parsed.count("stats") || parsed.count("stats-json") ? &stats : nullptr;
+  return options;
+}
+
+// Paths in the manifest are relative to root, the same names --tar would use
+bool save_manifest(const cxxopts::ParseResult& parsed, const std::vector<BOLT::manifest_entry_t>& entries, const std::filesystem::path& root) {
+  std::filesystem::path manifest_path = parsed["manifest"].as<std::string>();
+  std::ofstream out(manifest_path, std::ios::binary);
+  BOLT::write_manifest(out, *manifest_format(parsed), entries, root, true);
+  if (!out.flush()) {
+    std::cerr << "Can't write " << manifest_path.string() << "\n";
+    return false;
+  }
+  return true;
+}
+
+bool save_stats(const cxxopts::ParseResult& parsed, const BOLT::decode_stats_t& stats, const std::filesystem::path& root) {
+  if (parsed.count("stats")) {
+    std::ostringstream ss;
+    BOLT::print_stats_summary(ss, stats, root);
+    std::cerr << ss.str();
+  }
+  if (!parsed.count("stats-json")) return true;
+
+  std::filesystem::path stats_path = parsed["stats-json"].as<std::string>();
+  std::ofstream out(stats_path, std::ios::binary);
+  BOLT::write_stats_json(out, stats, root);
+  if (!out.flush()) {
+    std::cerr << "Can't write " << stats_path.string() << "\n";
+    return false;
+  }
+  return true;
+}
+
+int run_batch(const cxxopts::ParseResult& parsed) {
+  std::filesystem::path list_path = std::filesystem::absolute(parsed["list"].as<std::string>());
+
+  // Each rom goes to a directory named after it, next to the rom unless -o is given
+  bool is_dir = std::filesystem::is_directory(list_path);
+  std::filesystem::path output_root = is_dir ? list_path : list_path.parent_path();
+  if (parsed.count("output")) {
+    output_root = std::filesystem::absolute(parsed["output"].as<std::string>());
+  }
+
+  std::vector<BOLT::batch_input_t> inputs;
+  if (is_dir) {
+    read_list_dir(list_path, parsed, output_root, inputs);
+  }
+  else if (!read_list_file(list_path, parsed, output_root, inputs)) {
+    return 1;
+  }
+
+  if (inputs.empty()) {
+    std::cerr << "Nothing to extract in " << list_path.string() << "\n";
+    return 1;
+  }
+
+  try {
+    std::vector<BOLT::manifest_entry_t> manifest;
+    BOLT::decode_stats_t stats;
+    bool ok = parsed.count("verify")
+      ? BOLT::verify_batch(inputs, extract_options(parsed, output_root, manifest, stats), output_root, std::cout)
+      : BOLT::extract_batch(inputs, extract_options(parsed, output_root, manifest, stats));
+    if (parsed.count("manifest")) ok = save_manifest(parsed, manifest, output_root) && ok;
+    if (parsed.count("stats") || parsed.count("stats-json")) ok = save_stats(parsed, stats, output_root) && ok;
+    return ok ? 0 : 1;
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+}
+
+int main(int argc, const char **argv)
+{
+  cxxopts::Options cmd("bolt-extract", "Extract Mass Media's BOLT archive from binaries.");
+  configure(cmd);
+
+  auto parsed = cmd.parse(argc, argv);
+  
+  if (parsed.count("help")) {
+    show_help(cmd);
+    return 0;
+  }
+
+  if (!manifest_format(parsed)) {
+    std::cerr << "Unknown format " << parsed["format"].as<std::string>() << ", use json or csv.\n";
+    return 1;
+  }
+  std::string endian = parsed["endian"].as<std::string>();
+  if (endian != "auto" && endian != "little" && endian != "big") {
+    std::cerr << "Unknown byte order " << endian << ", use auto, little or big.\n";
+    return 1;
+  }
+  if (parsed["big"].as<bool>() && endian == "little") {
+    std::cerr << "-b and --endian little contradict each other.\n";
+    return 1;
+  }
+  if (!dedupe_mode(parsed)) {
+    std::cerr << "Unknown dedupe mode " << parsed["dedupe"].as<std::string>() << ", use link or report.\n";
+    return 1;
+  }
+  if (parsed.count("incremental") && (parsed.count("tar") || parsed.count("cpio"))) {
+    std::cerr << "--incremental only works with loose files, not with --tar or --cpio.\n";
+    return 1;
+  }
+  if (parsed.count("verify") && (parsed.count("tar") || parsed.count("cpio") || parsed.count("incremental"))) {
+    std::cerr << "--verify doesn't write anything, it can't be combined with --tar, --cpio or --incremental.\n";
+    return 1;
+  }
+
+  if (parsed.count("bench") && !parsed.count("input")) {
+    BOLT::bench_options_t options;
+    options.corpus_size = std::size_t(parsed["bench-size"].as<unsigned>()) * 1024 * 1024;
+    options.reps = parsed["bench-reps"].as<unsigned>();
+    options.jobs = parsed["jobs"].as<unsigned>();
+    return BOLT::run_synthetic_benchmark(options) ? 0 : 1;
+  }
+
+  if (parsed.count("list")) {
+    check_debugger();
+    return run_batch(parsed);
+  }
+
+  if (!parsed.count("input")) {
+    std::cerr << "Missing input file.\n";
+    show_help(cmd);
+    return 1;
+  }
+
+  std::string input_file = parsed["input"].as<std::string>();
+  std::filesystem::path input_path = std::filesystem::absolute(input_file);
+
+  std::filesystem::path output_path = input_path.parent_path() / input_path.stem();
+  if (parsed.count("repack")) {
+    output_path = input_path.parent_path() / (input_path.filename().string() + ".bolt");
+  }
+  if (parsed.count("output")) {
+    output_path = std::filesystem::absolute(parsed["output"].as<std::string>());
+  }
+  
+  check_debugger();
+
+  std::string algo = parsed["algo"].as<std::string>();
+  std::optional<std::endian> chosen_order = chosen_byte_order(parsed);
+  if (parsed.count("detect")) {
+    try {
+      BOLT::print_format_scores(std::cout, BOLT::score_formats(input_path, determine_algorithm(input_path, algo), chosen_order));
+      return 0;
+    }
+    catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return 1;
+    }
+  }
+
+  // A folder to repack has nothing to detect from. Detecting reads all of the rom, so --get only does
+  // it when neither -a nor the extension name an algorithm.
+  BOLT::algorithm_t algorithm = determine_algorithm(input_path, algo);
+  std::endian byte_order = chosen_order.value_or(std::endian::little);
+  if (parsed.count("get") && algorithm != BOLT::algorithm_t::UNKNOWN) {
+    byte_order = chosen_order.value_or(platform_byte_order(input_path, algo));
+  }
+  else if (!parsed.count("repack")) {
+    resolve_format(input_path, algo, chosen_order, algorithm, byte_order);
+  }
+  if (algorithm == BOLT::algorithm_t::UNKNOWN) {
+    std::cerr << "Please choose a supported algorithm.\n";
+    show_help(cmd);
+    return 1;
+  }
+
+  if (parsed.count("index")) {
+    try {
+      return BOLT::index_bolt(input_path, algorithm, byte_order, *manifest_format(parsed), std::cout) ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return 1;
+    }
+  }
+
+  if (parsed.count("get")) {
+    try {
+      std::filesystem::path output = parsed.count("output") ? parsed["output"].as<std::string>() : "-";
+      return BOLT::get_entry(input_path, parsed["get"].as<std::string>(), algorithm, byte_order, output) ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return 1;
+    }
+  }
+
+  if (parsed.count("repack")) {
+    try {
+      std::optional<int> level;
+      if (parsed.count("level")) level = parsed["level"].as<int>();
+      return BOLT::repack_bolt(input_path, output_path, algorithm, byte_order, level, parsed["jobs"].as<unsigned>()) ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return 1;
+    }
+  }
+
+  if (parsed.count("bench")) {
+    BOLT::bench_options_t options;
+    options.reps = parsed["bench-reps"].as<unsigned>();
+    options.jobs = parsed["jobs"].as<unsigned>();
+    return BOLT::run_rom_benchmark(input_path, algorithm, byte_order, options) ? 0 : 1;
+  }
+
+  try {
+    // The archive stream holds the output directory itself, like tar'ing it up afterwards would
+    std::vector<BOLT::manifest_entry_t> manifest;
+    BOLT::decode_stats_t stats;
+    bool ok = parsed.count("verify")
+      ? BOLT::verify_batch({ { input_path, output_path, algorithm, byte_order } }, extract_options(parsed, output_path.parent_path(), manifest, stats), output_path.parent_path(), std::cout)
+      : BOLT::extract_bolt(input_path, output_path, algorithm, byte_order, extract_options(parsed, output_path.parent_path(), manifest, stats));
+    if (parsed.count("manifest")) ok = save_manifest(parsed, manifest, output_path.parent_path()) && ok;
+    if (parsed.count("stats") || parsed.count("stats-json")) ok = save_stats(parsed, stats, output_path.parent_path()) && ok;
+    return ok ? 0 : 1;
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+}
@@ -0,0 +1,113 @@
+#include <format>
+#include <string>
+
+#include "manifest.h"
+
+
+using namespace BOLT;
+
+namespace {
+  std::string csv_field(const std::string& s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos) return s;
+
+    std::string result = "\"";
+    for (char c : s) {
+      if (c == '"') result += '"';
+      result += c;
+    }
+    return result + "\"";
+  }
+}
+
+std::string BOLT::json_string(const std::string& s) {
+  std::string result = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') result += '\\';
+    if (static_cast<unsigned char>(c) < 0x20) {
+      result += std::format("\\u{:04x}", static_cast<int>(c));
+      continue;
+    }
+    result += c;
+  }
+  return result + "\"";
+}
+
+manifest_entry_t::manifest_entry_t(std::filesystem::path path, std::size_t archive_offset, const entry_t& entry, std::endian order)
+  : path(std::move(path))
+  , archive_offset(archive_offset)
+  , flags(entry.flags)
+  , unk_1(entry.unk_1)
+  , unk_2(entry.unk_2)
+  , file_type(entry.file_type)
+  , uncompressed_size(entry.uncompressed_size(order))
+  , data_offset(entry.data_offset(order))
+  , file_hash(entry.file_hash(order)) {}
+
+void BOLT::list_entries(const bolt_reader_t& reader, std::vector<manifest_entry_t>& entries) {
+  const std::vector<std::size_t>& archives = reader.archives();
+
+  for (std::size_t begin : archives) {
+    // Same layout collect_work extracts to
+    std::filesystem::path dir;
+    if (archives.size() > 1) {
+      dir = std::format("{:08X}", begin);
+    }
+
+    // The listing is meant to work on anything, a folder table the walk can't follow is only reported
+    reader.walk_archive(begin, [&](const entry_t& entry, std::span<const unsigned> indices) {
+      std::filesystem::path path = dir;
+      for (unsigned i : indices) path /= std::format("{:03X}", i);
+      entries.emplace_back(path, begin, entry, reader.get_byte_order());
+      entries.back().is_folder = entry.file_hash_be == 0;
+      return bolt_reader_t::walk_step_t::DESCEND;
+    });
+  }
+}
+
+void BOLT::write_manifest(std::ostream& out, manifest_format_t format, const std::vector<manifest_entry_t>& entries, const std::filesystem::path& root, bool with_decode) {
+  auto path_of = [&](const manifest_entry_t& e) {
+    return (root.empty() ? e.path : e.path.lexically_relative(root)).generic_string();
+  };
+
+  if (format == manifest_format_t::CSV) {
+    out << "path,kind,archive_offset,flags,unk_1,unk_2,file_type,uncompressed_size,data_offset,file_hash";
+    if (with_decode) out << ",guessed_type,detector,compressed_size,decoded_size,decode_us,error";
+    out << "\n";
+
+    for (const manifest_entry_t& e : entries) {
+      out << csv_field(path_of(e)) << "," << (e.is_folder ? "folder" : "file") << ","
+        << std::format("{},{},{},{},{},{},{},{:08X}", e.archive_offset, unsigned(e.flags), unsigned(e.unk_1), unsigned(e.unk_2), unsigned(e.file_type), e.uncompressed_size, e.data_offset, e.file_hash);
+      if (with_decode) {
+        out << std::format(",{},{},{},{},{:.1f},{}", type_extension(e.guessed_type) + 1, csv_field(type_detector(e.guessed_type)), e.compressed_size, e.decoded_size, e.decode_time.count() / 1000.0, error_kind_name(e.error.kind));
+      }
+      out << "\n";
+    }
+    return;
+  }
+
+  out << "[";
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    const manifest_entry_t& e = entries[i];
+    out << (i == 0 ? "\n" : ",\n")
+      << "  {\"path\": " << json_string(path_of(e)) << ", \"kind\": \"" << (e.is_folder ? "folder" : "file") << "\""
+      << std::format(", \"archive_offset\": {}, \"flags\": {}, \"unk_1\": {}, \"unk_2\": {}, \"file_type\": {}", e.archive_offset, unsigned(e.flags), unsigned(e.unk_1), unsigned(e.unk_2), unsigned(e.file_type))
+      << std::format(", \"uncompressed_size\": {}, \"data_offset\": {}, \"file_hash\": \"{:08X}\"", e.uncompressed_size, e.data_offset, e.file_hash);
+    if (with_decode) {
+      out << ", \"guessed_type\": \"" << type_extension(e.guessed_type) + 1 << "\", \"detector\": " << json_string(type_detector(e.guessed_type))
+        << std::format(", \"compressed_size\": {}, \"decoded_size\": {}, \"decode_us\": {:.1f}", e.compressed_size, e.decoded_size, e.decode_time.count() / 1000.0)
+        << ", \"error\": " << (e.error ? json_string(error_kind_name(e.error.kind)) : "null");
+    }
+    out << "}";
+  }
+  out << "\n]\n";
+}
+
+bool BOLT::index_bolt(const std::filesystem::path& input_file, algorithm_t algorithm, std::endian byte_order, manifest_format_t format, std::ostream& out) {
+  bolt_reader_t reader{ algorithm, byte_order };
+  reader.read_from_file(input_file);
+
+  std::vector<manifest_entry_t> entries;
+  list_entries(reader, entries);
+  write_manifest(out, format, entries, {}, false);
+  return bool(out.flush());
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <bit>
+
+#include "bolt.h"
+#include "codec.h"
+#include "guess_type.h"
+
+
+namespace BOLT {
+  enum class manifest_format_t {
+    JSON,
+    CSV,
+  };
+
+  // One row of a listing or extraction manifest, with the header fields already in host byte order
+  struct manifest_entry_t {
+    std::filesystem::path path;
+    std::size_t archive_offset = 0;  // of the BOLT header data_offset is relative to
+    bool is_folder = false;
+
+    std::uint8_t flags = 0;
+    std::uint8_t unk_1 = 0;
+    std::uint8_t unk_2 = 0;
+    std::uint8_t file_type = 0;
+    std::uint32_t uncompressed_size = 0;
+    std::uint32_t data_offset = 0;
+    std::uint32_t file_hash = 0;
+
+    // Only filled in by an extraction
+    file_type_t guessed_type = file_type_t::UNKNOWN;
+    std::size_t compressed_size = 0;  // bytes of the rom the decoder read
+    std::size_t decoded_size = 0;
+    std::chrono::nanoseconds decode_time{ 0 };
+    decode_error_t error;
+
+    manifest_entry_t() = default;
+    manifest_entry_t(std::filesystem::path path, std::size_t archive_offset, const entry_t& entry, std::endian order);
+  };
+
+  // Every file and folder of every archive in the rom, read from the entry tables alone. Paths look
+  // like 01A/003, with the archive's offset in front when the rom holds more than one.
+  void list_entries(const bolt_reader_t& reader, std::vector<manifest_entry_t>& entries);
+
+  // Quoted and escaped for JSON
+  std::string json_string(const std::string& s);
+
+  // Paths are written relative to root, unless it is empty. with_decode adds the extraction columns.
+  void write_manifest(std::ostream& out, manifest_format_t format, const std::vector<manifest_entry_t>& entries, const std::filesystem::path& root, bool with_decode);
+
+  // --index: prints the listing of one rom without decoding anything
+  bool index_bolt(const std::filesystem::path& input_file, algorithm_t algorithm, std::endian byte_order, manifest_format_t format, std::ostream& out);
+}
@@ -0,0 +1,133 @@
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped_file.h"
+
+
+using namespace BOLT;
+
+#ifdef _WIN32
+
+void mapped_file_t::open(const std::filesystem::path& filename) {
+  close();
+
+  h_file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (h_file == INVALID_HANDLE_VALUE) {
+    h_file = nullptr;
+    throw std::runtime_error("Failed to open " + filename.string());
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(h_file, &file_size)) {
+    throw std::runtime_error("Failed to get size of " + filename.string());
+  }
+  if (file_size.QuadPart == 0) return;
+
+  h_map = CreateFileMappingW(h_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (h_map == nullptr) {
+    throw std::runtime_error("Failed to map " + filename.string());
+  }
+
+  view = static_cast<const std::byte*>(MapViewOfFile(h_map, FILE_MAP_READ, 0, 0, 0));
+  if (view == nullptr) {
+    throw std::runtime_error("Failed to map view of " + filename.string());
+  }
+  view_size = static_cast<std::size_t>(file_size.QuadPart);
+}
+
+void mapped_file_t::advise(std::size_t offset, std::size_t size, access_hint_t hint) const {
+  if (offset >= view_size) return;
+  size = std::min(size, view_size - offset);
+
+  // Windows has no per-range equivalent of sequential/normal advice, only prefetching
+  if (hint == access_hint_t::WILLNEED) {
+    WIN32_MEMORY_RANGE_ENTRY range{ const_cast<std::byte*>(view + offset), size };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+  }
+}
+
+void mapped_file_t::close() {
+  if (view) UnmapViewOfFile(view);
+  if (h_map) CloseHandle(h_map);
+  if (h_file) CloseHandle(h_file);
+
+  view = nullptr;
+  view_size = 0;
+  h_map = h_file = nullptr;
+}
+
+#else
+
+void mapped_file_t::open(const std::filesystem::path& filename) {
+  close();
+
+  fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open " + filename.string());
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    throw std::runtime_error("Failed to get size of " + filename.string());
+  }
+  if (st.st_size == 0) return;
+
+  void* p = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) {
+    throw std::runtime_error("Failed to map " + filename.string());
+  }
+
+  view = static_cast<const std::byte*>(p);
+  view_size = static_cast<std::size_t>(st.st_size);
+}
+
+void mapped_file_t::advise(std::size_t offset, std::size_t size, access_hint_t hint) const {
+  if (offset >= view_size) return;
+  size = std::min(size, view_size - offset);
+
+  // madvise wants a page aligned address
+  static const std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  std::size_t aligned = offset & ~(page_size - 1);
+  size += offset - aligned;
+
+  int advice = MADV_NORMAL;
+  switch (hint) {
+  case access_hint_t::NORMAL:
+    advice = MADV_NORMAL;
+    break;
+  case access_hint_t::SEQUENTIAL:
+    advice = MADV_SEQUENTIAL;
+    break;
+  case access_hint_t::WILLNEED:
+    advice = MADV_WILLNEED;
+    break;
+  }
+  madvise(const_cast<std::byte*>(view + aligned), size, advice);
+}
+
+void mapped_file_t::close() {
+  if (view) munmap(const_cast<std::byte*>(view), view_size);
+  if (fd >= 0) ::close(fd);
+
+  view = nullptr;
+  view_size = 0;
+  fd = -1;
+}
+
+#endif
+
+mapped_file_t::~mapped_file_t() {
+  close();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <filesystem>
+
+
+namespace BOLT {
+  enum class access_hint_t {
+    NORMAL,
+    SEQUENTIAL,
+    WILLNEED,
+  };
+
+  // Read-only memory mapping of an input file. Pages are only brought in when touched.
+  class mapped_file_t {
+  private:
+    const std::byte* view = nullptr;
+    std::size_t view_size = 0;
+
+#ifdef _WIN32
+    void* h_file = nullptr;
+    void* h_map = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    void close();
+  public:
+    void open(const std::filesystem::path& filename);
+
+    // Tell the OS how a range of the mapping is about to be accessed. Only a hint, failures are ignored.
+    void advise(std::size_t offset, std::size_t size, access_hint_t hint) const;
+
+    std::span<const std::byte> data() const { return { view, view_size }; }
+    std::size_t size() const { return view_size; }
+
+    mapped_file_t() = default;
+    mapped_file_t(const mapped_file_t&) = delete;
+    mapped_file_t& operator=(const mapped_file_t&) = delete;
+    ~mapped_file_t();
+  };
+}
@@ -0,0 +1,145 @@
+#include <cstdint>
+#include <cstring>
+
+#include "match_copy.h"
+#include "cpu_features.h"
+
+
+using namespace BOLT;
+
+namespace {
+  void copy_scalar(std::byte* dst, std::size_t rel_offset, std::size_t length) {
+    const std::byte* src = dst - rel_offset;
+    for (std::size_t i = 0; i < length; ++i) {
+      dst[i] = src[i];
+    }
+  }
+
+  void reverse_scalar(std::byte* dst, const std::byte* src_last, std::size_t length) {
+    for (std::size_t i = 0; i < length; ++i) {
+      dst[i] = *(src_last - i);
+    }
+  }
+
+  // An overlapping copy repeats the rel_offset bytes before dst forever. Fill `pattern` with enough
+  // repetitions for one vector, and return the largest multiple of rel_offset that fits in `width`
+  // so consecutive stores stay in phase.
+  std::size_t build_pattern(std::byte* pattern, const std::byte* src, std::size_t rel_offset, std::size_t width) {
+    for (std::size_t i = 0; i < width; ++i) {
+      pattern[i] = src[i % rel_offset];
+    }
+    return width - width % rel_offset;
+  }
+
+#ifdef BOLT_X86
+  BOLT_TARGET("sse2")
+  void copy_sse2(std::byte* dst, std::size_t rel_offset, std::size_t length) {
+    const std::byte* src = dst - rel_offset;
+
+    if (rel_offset == 1) {
+      std::memset(dst, std::to_integer<int>(*src), length);
+      return;
+    }
+
+    if (rel_offset < 16) {
+      alignas(16) std::byte pattern[16];
+      std::size_t step = build_pattern(pattern, src, rel_offset, 16);
+      __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern));
+
+      std::size_t i = 0;
+      for (; i + 16 <= length; i += step) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+      }
+      // i is a multiple of rel_offset here, so the pattern starts in phase
+      std::memcpy(dst + i, pattern, length - i);
+      return;
+    }
+
+    // Every load only touches bytes at least 16 behind the store, which are already final
+    std::size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+    }
+    if (i < length) {
+      std::size_t last = length - 16;
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + last), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + last)));
+    }
+  }
+
+  BOLT_TARGET("sse2")
+  __m128i reverse_bytes_sse2(__m128i v) {
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+  }
+
+  BOLT_TARGET("sse2")
+  void reverse_sse2(std::byte* dst, const std::byte* src_last, std::size_t length) {
+    std::size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_last - i - 15));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), reverse_bytes_sse2(v));
+    }
+    reverse_scalar(dst + i, src_last - i, length - i);
+  }
+
+  BOLT_TARGET("avx2")
+  void copy_avx2(std::byte* dst, std::size_t rel_offset, std::size_t length) {
+    if (length < 32) {
+      copy_sse2(dst, rel_offset, length);
+      return;
+    }
+
+    const std::byte* src = dst - rel_offset;
+
+    if (rel_offset < 32) {
+      alignas(32) std::byte pattern[32];
+      std::size_t step = build_pattern(pattern, src, rel_offset, 32);
+      __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern));
+
+      std::size_t i = 0;
+      for (; i + 32 <= length; i += step) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+      }
+      std::memcpy(dst + i, pattern, length - i);
+      return;
+    }
+
+    std::size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+    }
+    if (i < length) {
+      std::size_t last = length - 32;
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + last), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + last)));
+    }
+  }
+
+  BOLT_TARGET("avx2")
+  void reverse_avx2(std::byte* dst, const std::byte* src_last, std::size_t length) {
+    const __m256i lane_reverse = _mm256_setr_epi8(
+      15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+      15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+    std::size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_last - i - 31));
+      v = _mm256_shuffle_epi8(v, lane_reverse);
+      v = _mm256_permute2x128_si256(v, v, 0x01);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+    reverse_sse2(dst + i, src_last - i, length - i);
+  }
+#endif
+
+  match_kernels_t select_match_kernels() {
+#ifdef BOLT_X86
+    if (cpu_has_avx2()) return { "avx2", copy_avx2, reverse_avx2 };
+    if (cpu_has_sse2()) return { "sse2", copy_sse2, reverse_sse2 };
+#endif
+    return { "scalar", copy_scalar, reverse_scalar };
+  }
+}
+
+const match_kernels_t BOLT::g_match_kernels = select_match_kernels();
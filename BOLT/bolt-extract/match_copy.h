@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+
+
+namespace BOLT {
+  // Forward LZ copy of length bytes from rel_offset behind dst. Source and destination may overlap.
+  using match_copy_fn = void (*)(std::byte* dst, std::size_t rel_offset, std::size_t length);
+
+  // dst[i] = src_last[-i], the source lies entirely before dst.
+  using reverse_copy_fn = void (*)(std::byte* dst, const std::byte* src_last, std::size_t length);
+
+  struct match_kernels_t {
+    const char* name;
+    match_copy_fn copy;
+    reverse_copy_fn reverse;
+  };
+
+  // Runs shorter than this are copied inline, the call isn't worth it
+  constexpr std::size_t MATCH_KERNEL_MIN = 16;
+
+  // Chosen once at startup, AVX2 or SSE2 when the CPU has them, scalar otherwise
+  extern const match_kernels_t g_match_kernels;
+}
@@ -1,61 +1,61 @@
-#include "bolt.h"
-#include "util.h"
-
-using namespace BOLT;
-
-
-// Decompress algorithm used by N64 and GBA games. (entirely guessed)
-void bolt_reader_t::decompress_n64(std::uint32_t offset, std::uint32_t expected_size, std::vector<std::byte>& result) {
-  set_cur_pos(offset);
-
-  std::uint32_t op_count = 0;
-  std::uint32_t ext_offset = 0;
-  std::uint32_t ext_run = 0;
-
-  while (result.size() < expected_size) {
-    std::uint8_t bytevalue = static_cast<std::uint8_t>(read_u8());
-    op_count++;
-
-    if (bytevalue & 0x80) {
-      if (bytevalue & 0x40) {  // extension in offset
-        ext_offset <<= 6;
-        ext_offset |= bytevalue & 0x3F;
-      }
-      else if (bytevalue & 0x20) {  // extension in runlength
-        ext_run <<= 5;
-        ext_run |= bytevalue & 0x1F;
-      }
-      else if (bytevalue & 0x10) { // extension in both runlength and offset
-        ext_run <<= 2;
-        ext_offset <<= 2;
-
-        ext_offset |= (bytevalue & 0b1100) >> 2;
-        ext_run |= (bytevalue & 0b0011);
-      }
-      else { // uncompressed
-        std::uint32_t run_length = ((ext_run << 4) | (bytevalue & 0xF)) + 1;
-        for (unsigned i = 0; i < run_length; ++i) {
-          result.push_back(read_u8());
-        }
-        op_count = ext_offset = ext_run = 0;
-      }
-    }
-    else {  // lookup
-      if (result.size() == 0) {
-        err_msg("lookup can't happen on first byte, something fishy is going on", bytevalue);
-        break;
-      }
-
-      std::uint32_t rel_offset = ((ext_offset << 4) | (bytevalue & 0xF)) + 1;
-      std::uint32_t run_length = ((ext_run << 3) | (bytevalue >> 4)) + op_count + 1;
-
-      if (result.size() < rel_offset) {
-        err_msg("lookbehind too far", bytevalue);
-        break;
-      }
-
-      reinsert_self(result, rel_offset, run_length);
-      op_count = ext_offset = ext_run = 0;
-    }
-  }
-}
+#include "codec.h"
+
+using namespace BOLT;
+
+
+// Decompress algorithm used by N64 and GBA games. (entirely guessed)
+template<class check_t>
+decode_status_t n64_codec_t<check_t>::run(output_window_t& out) {
+  if (!flush_pending(out)) return decode_status_t::OUTPUT_FULL;
+
+  while (out.dst < out.end) {
+    if (!has_input<check_t>(1)) return fail_input(out);
+    std::uint8_t bytevalue = static_cast<std::uint8_t>(read_u8());
+    opcode = bytevalue;
+    op_count++;
+
+    if (bytevalue & 0x80) {
+      if (bytevalue & 0x40) {  // extension in offset
+        ext_offset <<= 6;
+        ext_offset |= bytevalue & 0x3F;
+        count<check_t>(2);
+      }
+      else if (bytevalue & 0x20) {  // extension in runlength
+        ext_run <<= 5;
+        ext_run |= bytevalue & 0x1F;
+        count<check_t>(3);
+      }
+      else if (bytevalue & 0x10) { // extension in both runlength and offset
+        ext_run <<= 2;
+        ext_offset <<= 2;
+
+        ext_offset |= (bytevalue & 0b1100) >> 2;
+        ext_run |= (bytevalue & 0b0011);
+        count<check_t>(4);
+      }
+      else { // uncompressed
+        std::uint32_t run_length = ((ext_run << 4) | (bytevalue & 0xF)) + 1;
+        op_count = ext_offset = ext_run = 0;
+
+        if (!has_input<check_t>(run_length)) return fail_input(out);
+        count<check_t>(0, op_kind_t::LITERAL, run_length);
+        if (!emit_literal(out, run_length)) return decode_status_t::OUTPUT_FULL;
+      }
+    }
+    else {  // lookup
+      std::uint32_t rel_offset = ((ext_offset << 4) | (bytevalue & 0xF)) + 1;
+      std::uint32_t run_length = ((ext_run << 3) | (bytevalue >> 4)) + op_count + 1;
+
+      if (!has_lookbehind<check_t>(out, rel_offset)) return fail_lookbehind(out);
+
+      op_count = ext_offset = ext_run = 0;
+      count<check_t>(1, op_kind_t::MATCH, run_length, rel_offset);
+      if (!emit_match(out, rel_offset, run_length)) return decode_status_t::OUTPUT_FULL;
+    }
+  }
+  return decode_status_t::OUTPUT_FULL;
+}
+
+template class BOLT::n64_codec_t<checked_t>;
+template class BOLT::n64_codec_t<unchecked_t>;
+template class BOLT::n64_codec_t<counted_t>;
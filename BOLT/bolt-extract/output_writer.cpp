@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+#include "output_writer.h"
+#include "util.h"
+
+
+using namespace BOLT;
+
+bool directory_sink_t::add_directory(const std::filesystem::path& dir) {
+  if (created_dirs.contains(dir.native())) return true;
+
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec) {
+    std::ostringstream ss;
+    ss << "Can't create " << dir << ": " << ec.message() << "\n";
+    std::cerr << ss.str();
+    return false;
+  }
+  created_dirs.insert(dir.native());
+  return true;
+}
+
+bool directory_sink_t::write_file(const std::filesystem::path& filename, std::span<const std::byte> data) {
+  if (!add_directory(filename.parent_path())) return false;
+
+  // If an earlier --dedupe link run made this a hardlink, rewriting it in place would change the other names too
+  std::error_code ec;
+  std::filesystem::remove(filename, ec);
+
+  std::ofstream ofile(filename, std::ios::binary);
+  ofile.write(reinterpret_cast<const char*>(data.data()), data.size());
+  if (!ofile) {
+    std::ostringstream ss;
+    ss << "Can't write " << filename << "\n";
+    std::cerr << ss.str();
+    return false;
+  }
+  return true;
+}
+
+bool directory_sink_t::link_file(const std::filesystem::path& filename, const std::filesystem::path& target) {
+  if (!add_directory(filename.parent_path())) return false;
+
+  // A file left from an earlier run would make the link fail, and writing it instead would leave it as it was
+  std::error_code ec;
+  std::filesystem::remove(filename, ec);
+  std::filesystem::create_hard_link(target, filename, ec);
+  return !ec;
+}
+
+bool directory_sink_t::same_content(const std::filesystem::path& target, std::span<const std::byte> data) {
+  std::error_code ec;
+  if (std::filesystem::file_size(target, ec) != data.size() || ec) return false;
+
+  // Read back a piece at a time, the first copy was just written and is still in the page cache
+  std::ifstream ifile(target, std::ios::binary);
+  std::vector<char> chunk(64 * 1024);
+  for (std::size_t pos = 0; pos < data.size(); pos += chunk.size()) {
+    std::size_t n = std::min(chunk.size(), data.size() - pos);
+    if (!ifile.read(chunk.data(), n)) return false;
+    if (std::memcmp(chunk.data(), data.data() + pos, n) != 0) return false;
+  }
+  return true;
+}
+
+output_writer_t::output_writer_t(std::unique_ptr<output_sink_t> sink, dedupe_mode_t dedupe, std::size_t max_in_flight)
+  : sink(std::move(sink)), max_in_flight(max_in_flight), dedupe(dedupe), discard(!this->sink->keeps_data() && dedupe == dedupe_mode_t::NONE), thread(&output_writer_t::writer_main, this) {}
+
+output_writer_t::~output_writer_t() {
+  {
+    std::lock_guard guard{ lock };
+    stopping = true;
+  }
+  work_available.notify_all();
+  thread.join();
+}
+
+void output_writer_t::enqueue(job_t job) {
+  std::unique_lock guard{ lock };
+  // A file larger than the whole budget still goes through, on its own
+  progress.wait(guard, [&] { return in_flight == 0 || in_flight + job.data.size() <= max_in_flight; });
+  in_flight += job.data.size();
+  queue.push_back(std::move(job));
+  guard.unlock();
+
+  work_available.notify_one();
+}
+
+void output_writer_t::write(std::filesystem::path filename, std::span<const std::byte> data) {
+  if (discard) return;
+  enqueue({ std::move(filename), std::vector<std::byte>(data.begin(), data.end()), false });
+}
+
+void output_writer_t::write_borrowed(std::filesystem::path filename, std::span<const std::byte> data) {
+  if (discard) return;
+  enqueue({ std::move(filename), {}, false, data });
+}
+
+void output_writer_t::add_directory(std::filesystem::path dir) {
+  if (discard) return;
+  enqueue({ std::move(dir), {}, true });
+}
+
+bool output_writer_t::flush() {
+  std::unique_lock guard{ lock };
+  progress.wait(guard, [&] { return queue.empty() && !writing; });
+  return failures == 0;
+}
+
+bool output_writer_t::close() {
+  bool ok = flush();
+  if (!finished) {
+    finished = true;
+    ok = sink->finish() && ok;
+  }
+  return ok;
+}
+
+bool output_writer_t::write_job(const job_t& job) {
+  if (job.is_dir) return sink->add_directory(job.filename);
+
+  std::span<const std::byte> data = job.bytes();
+  if (dedupe == dedupe_mode_t::NONE || data.empty()) return sink->write_file(job.filename, data);
+
+  // Hash and size are enough to report a file, a link makes both names one file so the bytes are compared first
+  std::uint64_t hash = fnv1a_64(data);
+  auto first = first_copies.find(hash);
+  if (first == first_copies.end() || first->second.size != data.size()) {
+    bool ok = sink->write_file(job.filename, data);
+    if (ok && first == first_copies.end()) {
+      first_copy_t copy{ job.filename, data.size() };
+      if (dedupe == dedupe_mode_t::LINK && !sink->reads_back() && kept_bytes + data.size() <= max_in_flight) {
+        copy.bytes.assign(data.begin(), data.end());
+        kept_bytes += data.size();
+      }
+      first_copies.emplace(hash, std::move(copy));
+    }
+    return ok;
+  }
+
+  // Past the budget for kept copies, a stream sink can only report the file
+  bool link = false;
+  if (dedupe == dedupe_mode_t::LINK) {
+    const first_copy_t& copy = first->second;
+    bool kept = copy.bytes.size() == data.size();
+    bool same = sink->reads_back() ? sink->same_content(copy.filename, data) : kept && std::ranges::equal(copy.bytes, data);
+    if (!same && (sink->reads_back() || kept)) return sink->write_file(job.filename, data);  // only the hash matched
+    link = same;
+  }
+
+  duplicates++;
+  duplicate_bytes += data.size();
+  if (!link) {
+    std::ostringstream ss;
+    ss << job.filename.string() << " is the same as " << first->second.filename.string() << "\n";
+    std::cerr << ss.str();
+  }
+  else if (sink->link_file(job.filename, first->second.filename)) {
+    return true;
+  }
+  return sink->write_file(job.filename, data);
+}
+
+void output_writer_t::writer_main() {
+  std::vector<job_t> batch;
+  for (;;) {
+    {
+      std::unique_lock guard{ lock };
+      work_available.wait(guard, [&] { return !queue.empty() || stopping; });
+      if (queue.empty()) return;
+
+      batch.swap(queue);
+      writing = true;
+    }
+
+    std::size_t written = 0;
+    std::size_t failed = 0;
+    for (const job_t& job : batch) {
+      if (!write_job(job)) failed++;
+      written += job.data.size();
+    }
+    batch.clear();
+
+    {
+      std::lock_guard guard{ lock };
+      in_flight -= written;
+      failures += failed;
+      writing = false;
+    }
+    progress.notify_all();
+  }
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+namespace BOLT {
+  // What the writer does with a file whose content it already wrote under another name
+  enum class dedupe_mode_t {
+    NONE,
+    REPORT,  // writes it anyway and names both on stderr
+    LINK,    // hardlinks it to the first copy once the bytes compare equal, writes it otherwise
+  };
+
+  // Where the writer thread puts extracted files. Never called from two threads at once.
+  class output_sink_t {
+  public:
+    virtual bool write_file(const std::filesystem::path& filename, std::span<const std::byte> data) = 0;
+    virtual bool add_directory(const std::filesystem::path& dir) = 0;
+
+    // Makes filename a hardlink to target, which was written before. False if that isn't possible,
+    // the data is then written normally.
+    virtual bool link_file(const std::filesystem::path& filename, const std::filesystem::path& target) { return false; }
+
+    // Whether target, written before, holds exactly data. Only asked if reads_back().
+    virtual bool same_content(const std::filesystem::path& target, std::span<const std::byte> data) { return false; }
+    virtual bool reads_back() const { return false; }
+
+    // After the last file
+    virtual bool finish() { return true; }
+
+    // False if the sink throws files away, the writer then doesn't copy or queue them at all
+    virtual bool keeps_data() const { return true; }
+
+    virtual ~output_sink_t() = default;
+  };
+
+  // Loose files, each directory is created once
+  class directory_sink_t : public output_sink_t {
+  private:
+    std::unordered_set<std::filesystem::path::string_type> created_dirs;
+
+  public:
+    bool write_file(const std::filesystem::path& filename, std::span<const std::byte> data) override;
+    bool add_directory(const std::filesystem::path& dir) override;
+    bool link_file(const std::filesystem::path& filename, const std::filesystem::path& target) override;
+    bool same_content(const std::filesystem::path& target, std::span<const std::byte> data) override;
+    bool reads_back() const override { return true; }
+  };
+
+  // Nothing is written anywhere, for timing and checking the decode alone
+  class null_sink_t : public output_sink_t {
+  public:
+    bool write_file(const std::filesystem::path& filename, std::span<const std::byte> data) override { return true; }
+    bool add_directory(const std::filesystem::path& dir) override { return true; }
+    bool keeps_data() const override { return false; }
+  };
+
+  // Write-behind stage for extracted files. Decoding threads hand finished files over and carry on,
+  // a background thread passes whatever has queued up to the sink in one batch. Handing over
+  // blocks while more than max_in_flight bytes are still waiting for the disk.
+  // With dedupe, the writer thread hashes every file and handles repeated content as dedupe says.
+  class output_writer_t {
+  private:
+    struct job_t {
+      std::filesystem::path filename;
+      std::vector<std::byte> data;
+      bool is_dir;
+      std::span<const std::byte> borrowed = {};  // written instead of data, see write_borrowed
+
+      std::span<const std::byte> bytes() const { return borrowed.empty() ? std::span<const std::byte>(data) : borrowed; }
+    };
+
+    struct first_copy_t {
+      std::filesystem::path filename;
+      std::size_t size;
+      std::vector<std::byte> bytes;  // to compare against before linking, when the sink can't read it back
+    };
+
+    std::unique_ptr<output_sink_t> sink;
+
+    std::mutex lock;
+    std::condition_variable work_available;
+    std::condition_variable progress;
+
+    std::vector<job_t> queue;
+    std::size_t in_flight = 0;  // bytes queued or being written
+    std::size_t max_in_flight;
+    bool writing = false;
+    bool stopping = false;
+    bool finished = false;
+    std::size_t failures = 0;
+
+    // Only touched by the writer thread until flush() returns
+    dedupe_mode_t dedupe;
+    bool discard;  // the sink doesn't keep anything and there's nothing to hash either
+    std::unordered_map<std::uint64_t, first_copy_t> first_copies;  // by fnv1a_64 of the content
+    std::size_t kept_bytes = 0;  // in first_copies, at most max_in_flight
+    std::size_t duplicates = 0;
+    std::size_t duplicate_bytes = 0;
+
+    std::thread thread;
+
+    void enqueue(job_t job);
+    bool write_job(const job_t& job);
+    void writer_main();
+
+  public:
+    // Copies data, the caller's buffer can be reused as soon as this returns
+    void write(std::filesystem::path filename, std::span<const std::byte> data);
+
+    // Like write, without the copy. data has to stay valid until flush() returns, which is the case
+    // for stored entries pointing into a mapped rom. Doesn't count against max_in_flight, the
+    // mapping holds on to the bytes either way.
+    void write_borrowed(std::filesystem::path filename, std::span<const std::byte> data);
+
+    // Makes sure the directory exists even if no file ends up in it
+    void add_directory(std::filesystem::path dir);
+
+    // Blocks until everything handed over so far is written. False if any file failed.
+    bool flush();
+
+    // Flushes and lets the sink finish up, nothing can be written after this
+    bool close();
+
+    // Files that had the same content as one written before, and their total size. Only counted
+    // with dedupe, and only final after flush().
+    std::size_t duplicate_files() const { return duplicates; }
+    std::size_t duplicate_size() const { return duplicate_bytes; }
+
+    explicit output_writer_t(std::unique_ptr<output_sink_t> sink = std::make_unique<directory_sink_t>(), dedupe_mode_t dedupe = dedupe_mode_t::NONE, std::size_t max_in_flight = 64 * 1024 * 1024);
+    output_writer_t(const output_writer_t&) = delete;
+    output_writer_t& operator=(const output_writer_t&) = delete;
+    ~output_writer_t();
+  };
+}
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+#include "repack.h"
+#include "compress.h"
+#include "codec.h"
+#include "thread_pool.h"
+#include "util.h"
+
+
+using namespace BOLT;
+
+namespace {
+  class archive_writer_t {
+  private:
+    algorithm_t algorithm;
+    std::endian byte_order;
+    std::vector<std::byte> rom;
+
+    void put_u16(std::size_t at, std::uint16_t v) {
+      v = bswap_if(v, byte_order);
+      std::memcpy(&rom[at], &v, sizeof(v));
+    }
+
+    void put_u32(std::size_t at, std::uint32_t v) {
+      v = bswap_if(v, byte_order);
+      std::memcpy(&rom[at], &v, sizeof(v));
+    }
+
+    // Folder tables are allocated at cursor, depth first
+    void place_tables(pack_node_t& dir, std::size_t table_offset, std::size_t& cursor) {
+      for (std::size_t i = 0; i < dir.children.size(); ++i) {
+        dir.children[i].entry_offset = table_offset + i * sizeof(entry_t);
+      }
+
+      for (pack_node_t& child : dir.children) {
+        if (!child.is_dir) continue;
+        std::size_t child_table = cursor;
+        cursor += child.children.size() * sizeof(entry_t);
+        place_tables(child, child_table, cursor);
+      }
+    }
+
+    void write_entries(pack_node_t& dir) {
+      for (pack_node_t& child : dir.children) {
+        std::byte* entry = &rom[child.entry_offset];
+
+        if (child.is_dir) {
+          std::size_t count = child.children.size();
+          if (algorithm == algorithm_t::XBOX) {
+            entry[2] = std::byte(count & 0xFF);
+            entry[3] = std::byte(count >> 8);
+          }
+          else {
+            entry[3] = std::byte(count & 0xFF);  // 256 wraps to 0, which means 256
+          }
+
+          std::size_t child_table = child.children.front().entry_offset;
+          put_u32(child.entry_offset + offsetof(entry_t, data_offset_be), static_cast<std::uint32_t>(child_table));
+          write_entries(child);
+          continue;
+        }
+
+        while (rom.size() % 4) rom.push_back(std::byte(0));
+        std::size_t data_offset = rom.size();
+        rom.insert(rom.end(), child.payload.begin(), child.payload.end());
+        std::vector<std::byte>().swap(child.payload);
+
+        // rom may have moved
+        entry = &rom[child.entry_offset];
+        entry[0] = std::byte(child.flags);
+        entry[3] = std::byte(child.file_type);
+        put_u32(child.entry_offset + offsetof(entry_t, uncompressed_size_be), child.uncompressed_size);
+        put_u32(child.entry_offset + offsetof(entry_t, data_offset_be), static_cast<std::uint32_t>(data_offset));
+        put_u32(child.entry_offset + offsetof(entry_t, file_hash_be), child.file_hash);
+      }
+    }
+
+  public:
+    std::vector<std::byte> write(pack_node_t& root) {
+      constexpr std::size_t HEADER_SIZE = offsetof(archive_t, entries);
+      std::size_t cursor = HEADER_SIZE + root.children.size() * sizeof(entry_t);
+      place_tables(root, HEADER_SIZE, cursor);
+      rom.resize(cursor);
+
+      std::memcpy(&rom[0], "BOLT", 4);
+      if (algorithm == algorithm_t::XBOX) {
+        put_u16(offsetof(archive_t_xbox, num_entries), static_cast<std::uint16_t>(root.children.size()));
+      }
+      else {
+        rom[offsetof(archive_t, num_entries)] = std::byte(root.children.size() & 0xFF);
+      }
+
+      write_entries(root);
+      put_u32(offsetof(archive_t, end_offset), static_cast<std::uint32_t>(rom.size()));
+      return std::move(rom);
+    }
+
+    archive_writer_t(algorithm_t algorithm, std::endian byte_order)
+      : algorithm(algorithm), byte_order(byte_order) {}
+  };
+
+  struct pack_source_t {
+    pack_node_t* node;
+    std::filesystem::path file;
+    std::uintmax_t size;
+  };
+
+  // "01A" for folders, "01A" or "01A.ext" for files, anything else isn't part of the archive
+  bool parse_entry_name(const std::string& name, bool is_dir, unsigned& index) {
+    if (name.size() < 3) return false;
+    for (int i = 0; i < 3; ++i) {
+      if (!std::isxdigit(static_cast<unsigned char>(name[i]))) return false;
+    }
+    if (is_dir ? name.size() != 3 : (name.size() > 3 && name[3] != '.')) return false;
+
+    index = static_cast<unsigned>(std::stoul(name.substr(0, 3), nullptr, 16));
+    return true;
+  }
+
+  // Child nodes are sized before recursing, so the pointers handed out in sources stay valid
+  void read_dir(pack_node_t& node, const std::filesystem::path& dir, algorithm_t algorithm, std::vector<pack_source_t>& sources) {
+    std::map<unsigned, std::filesystem::directory_entry> found;
+    for (const std::filesystem::directory_entry& item : std::filesystem::directory_iterator(dir)) {
+      unsigned index;
+      if (!parse_entry_name(item.path().filename().string(), item.is_directory(), index)) {
+        std::cerr << "Skipping " << item.path().string() << ", it isn't named like an extracted entry\n";
+        continue;
+      }
+      if (!found.emplace(index, item).second) {
+        throw std::runtime_error(std::format("More than one entry {:03X} in {}", index, dir.string()));
+      }
+    }
+
+    if (found.empty()) {
+      throw std::runtime_error(std::format("{} is empty, folders in an archive can't be", dir.string()));
+    }
+
+    std::size_t count = found.rbegin()->first + 1;
+    std::size_t limit = algorithm == algorithm_t::XBOX ? 0xFFFF : 256;
+    if (count > limit) {
+      throw std::runtime_error(std::format("{} has {} entries, at most {} fit in a folder", dir.string(), count, limit));
+    }
+
+    node.is_dir = true;
+    node.children.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      auto it = found.find(static_cast<unsigned>(i));
+      pack_node_t& child = node.children[i];
+
+      if (it == found.end()) {
+        std::cerr << std::format("No entry {:03X} in {}, writing an empty one\n", i, dir.string());
+        child.flags = FLAG_UNCOMPRESSED;
+      }
+      else if (it->second.is_directory()) {
+        read_dir(child, it->second.path(), algorithm, sources);
+      }
+      else {
+        sources.push_back({ &child, it->second.path(), it->second.file_size() });
+      }
+    }
+  }
+
+  std::vector<std::byte> read_file(const std::filesystem::path& filename, std::uintmax_t size) {
+    if (size > std::numeric_limits<std::uint32_t>::max()) {
+      throw std::runtime_error(filename.string() + " is too big for an archive entry");
+    }
+
+    std::vector<std::byte> data(size);
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(data.data()), data.size())) {
+      throw std::runtime_error("Failed to read " + filename.string());
+    }
+    return data;
+  }
+
+  // A stream that doesn't decode back to the input would silently break the game, so every one is checked
+  void check_round_trip(const std::filesystem::path& filename, std::span<const std::byte> data, std::span<const std::byte> compressed) {
+    std::vector<std::byte> check(data.size());
+    n64_codec_t<checked_t> codec{ compressed };
+    output_window_t window{ check.data(), check.data(), check.data() + check.size() };
+
+    if (codec.run(window) == decode_status_t::ERROR || codec.input_position() != compressed.size() || check != std::vector<std::byte>(data.begin(), data.end())) {
+      throw std::runtime_error("Compressed " + filename.string() + " doesn't decode back to the original");
+    }
+  }
+
+  void pack_file(const pack_source_t& source, int level) {
+    std::vector<std::byte> data = read_file(source.file, source.size);
+    pack_node_t& node = *source.node;
+
+    node.uncompressed_size = static_cast<std::uint32_t>(data.size());
+    node.file_hash = static_cast<std::uint32_t>(fnv1a_64(data)) | 1;
+
+    if (level > 0 && !data.empty()) {
+      std::vector<std::byte> compressed = compress_n64(data, level);
+      if (compressed.size() < data.size()) {
+        check_round_trip(source.file, data, compressed);
+        node.flags = 0;
+        node.payload = std::move(compressed);
+        return;
+      }
+    }
+
+    node.flags = FLAG_UNCOMPRESSED;
+    node.payload = std::move(data);
+  }
+}
+
+std::vector<std::byte> BOLT::write_archive(pack_node_t& root, algorithm_t algorithm, std::endian byte_order) {
+  return archive_writer_t{ algorithm, byte_order }.write(root);
+}
+
+bool BOLT::repack_bolt(const std::filesystem::path& input_dir, const std::filesystem::path& output_file, algorithm_t algorithm, std::endian byte_order, std::optional<int> requested_level, unsigned jobs) {
+  int level = 0;
+  if (algorithm == algorithm_t::N64 || algorithm == algorithm_t::XBOX) {
+    level = requested_level.value_or(DEFAULT_REPACK_LEVEL);
+  }
+  else if (requested_level.value_or(0) > 0) {
+    std::cerr << "Only the n64/gba/xbox/ps2 format can be compressed, storing every entry instead.\n";
+  }
+
+  pack_node_t root;
+  std::vector<pack_source_t> sources;
+  read_dir(root, input_dir, algorithm, sources);
+
+  if (jobs == 1) {
+    for (const pack_source_t& source : sources) {
+      pack_file(source, level);
+    }
+  }
+  else {
+    // Largest first so a single huge entry doesn't end up as the tail
+    std::stable_sort(sources.begin(), sources.end(), [](const pack_source_t& a, const pack_source_t& b) {
+      return a.size > b.size;
+    });
+
+    thread_pool_t pool{ jobs };
+    std::vector<thread_pool_t::task_t> tasks;
+    tasks.reserve(sources.size());
+    for (const pack_source_t& source : sources) {
+      tasks.push_back([&source, level](unsigned) {
+        pack_file(source, level);
+      });
+    }
+    pool.submit(std::move(tasks));
+    pool.wait();
+  }
+
+  std::vector<std::byte> archive = write_archive(root, algorithm, byte_order);
+
+  std::ofstream out(output_file, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(archive.data()), archive.size());
+  if (!out) {
+    throw std::runtime_error("Failed to write " + output_file.string());
+  }
+  return true;
+}
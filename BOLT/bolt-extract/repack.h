@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include <bit>
+
+#include "bolt.h"
+
+
+namespace BOLT {
+  // One entry of an archive being written
+  struct pack_node_t {
+    bool is_dir = false;
+    std::vector<pack_node_t> children;
+
+    std::uint8_t flags = 0;
+    std::uint8_t file_type = 0;
+    std::uint32_t uncompressed_size = 0;
+    std::uint32_t file_hash = 1;     // anything but 0, which marks a folder
+    std::vector<std::byte> payload;  // as it goes in the archive, compressed or stored
+
+    std::size_t entry_offset = 0;    // of this node's entry_t, filled in by write_archive
+  };
+
+  // Header and top level table first, then every folder's table, then the file data 4 byte aligned.
+  // Payloads are moved into the result.
+  std::vector<std::byte> write_archive(pack_node_t& root, algorithm_t algorithm, std::endian byte_order);
+
+  // Used for --repack when no level is given, on the formats that can be compressed
+  constexpr int DEFAULT_REPACK_LEVEL = 6;
+
+  // Builds an archive from a tree laid out the way extraction writes it. level 0 stores every
+  // entry, 1-9 compress them (N64/XBOX formats only). Without a level, the formats that can't be
+  // compressed are stored without a warning.
+  bool repack_bolt(const std::filesystem::path& input_dir, const std::filesystem::path& output_file, algorithm_t algorithm, std::endian byte_order, std::optional<int> level, unsigned jobs = 1);
+}
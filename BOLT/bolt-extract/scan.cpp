@@ -0,0 +1,98 @@
+#include <cstring>
+#include <bit>
+
+#include "scan.h"
+#include "cpu_features.h"
+
+
+using namespace BOLT;
+
+namespace {
+  bool is_magic_at(const std::byte* p) {
+    return std::memcmp(p, "BOLT", 4) == 0 || std::memcmp(p, "bolt", 4) == 0;
+  }
+
+  void scan_scalar(std::span<const std::byte> data, std::size_t from, std::vector<std::size_t>& found) {
+    for (std::size_t i = from; i + 4 <= data.size(); ++i) {
+      if (is_magic_at(&data[i])) found.push_back(i);
+    }
+  }
+
+  // Compares the first and last byte of the magic for a whole block at once. Only blocks where both
+  // line up get a full compare, which on binary data is almost never.
+#ifdef BOLT_X86
+  BOLT_TARGET("sse2")
+  void scan_sse2(std::span<const std::byte> data, std::vector<std::size_t>& found) {
+    const __m128i upper_first = _mm_set1_epi8('B');
+    const __m128i upper_last = _mm_set1_epi8('T');
+    const __m128i lower_first = _mm_set1_epi8('b');
+    const __m128i lower_last = _mm_set1_epi8('t');
+
+    const std::byte* base = data.data();
+    std::size_t i = 0;
+    for (; i + 3 + 16 <= data.size(); i += 16) {
+      __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + i));
+      __m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + i + 3));
+
+      __m128i upper = _mm_and_si128(_mm_cmpeq_epi8(first, upper_first), _mm_cmpeq_epi8(last, upper_last));
+      __m128i lower = _mm_and_si128(_mm_cmpeq_epi8(first, lower_first), _mm_cmpeq_epi8(last, lower_last));
+      unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(upper, lower)));
+
+      while (mask) {
+        unsigned bit = std::countr_zero(mask);
+        mask &= mask - 1;
+
+        if (is_magic_at(base + i + bit)) found.push_back(i + bit);
+      }
+    }
+    scan_scalar(data, i, found);
+  }
+
+  BOLT_TARGET("avx2")
+  void scan_avx2(std::span<const std::byte> data, std::vector<std::size_t>& found) {
+    const __m256i upper_first = _mm256_set1_epi8('B');
+    const __m256i upper_last = _mm256_set1_epi8('T');
+    const __m256i lower_first = _mm256_set1_epi8('b');
+    const __m256i lower_last = _mm256_set1_epi8('t');
+
+    const std::byte* base = data.data();
+    std::size_t i = 0;
+    for (; i + 3 + 32 <= data.size(); i += 32) {
+      __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + i));
+      __m256i last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + i + 3));
+
+      __m256i upper = _mm256_and_si256(_mm256_cmpeq_epi8(first, upper_first), _mm256_cmpeq_epi8(last, upper_last));
+      __m256i lower = _mm256_and_si256(_mm256_cmpeq_epi8(first, lower_first), _mm256_cmpeq_epi8(last, lower_last));
+      unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(upper, lower)));
+
+      while (mask) {
+        unsigned bit = std::countr_zero(mask);
+        mask &= mask - 1;
+
+        if (is_magic_at(base + i + bit)) found.push_back(i + bit);
+      }
+    }
+    scan_scalar(data, i, found);
+  }
+#endif
+}
+
+std::vector<std::size_t> BOLT::find_bolt_magics(std::span<const std::byte> data) {
+  std::vector<std::size_t> found;
+
+#ifdef BOLT_X86
+  static const bool has_avx2 = cpu_has_avx2();
+  static const bool has_sse2 = cpu_has_sse2();
+  if (has_avx2) {
+    scan_avx2(data, found);
+    return found;
+  }
+  if (has_sse2) {
+    scan_sse2(data, found);
+    return found;
+  }
+#endif
+
+  scan_scalar(data, 0, found);
+  return found;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <span>
+
+
+namespace BOLT {
+  // Offsets of every "BOLT" and "bolt" magic in data, in one pass and in ascending order.
+  std::vector<std::size_t> find_bolt_magics(std::span<const std::byte> data);
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <string>
+
+#include "stats.h"
+
+
+using namespace BOLT;
+
+namespace {
+  constexpr const char* N64_CLASSES[] = { "literal", "match", "offset ext", "length ext", "both ext" };
+  constexpr const char* DOS_CLASSES[] = { "literal", "near match", "far match", "fill", "skip" };
+
+  // CDI and Windows tokens are counted by their high nibble
+  constexpr const char* CDI_CLASSES[] = {
+    "literal", "literal", "zero fill", "fill", "short match", "short match", "short match", "short match",
+    "match", "far match", "long match", "far long match", "short reverse", "short reverse", "reverse", "far reverse",
+  };
+  constexpr const char* WIN_CLASSES[] = {
+    "literal", "pair fill", "match", "match", "fill", "long fill", "zero fill", "short match",
+    "short match", "short match", "short match", "short match", "split copy", "split copy", "split copy", "split copy",
+  };
+
+  constexpr const char* KIND_NAMES[] = { "literal", "match", "fill", "reverse" };
+
+  struct totals_t {
+    std::size_t files = 0;
+    std::uint64_t input_bytes = 0;
+    std::uint64_t output_bytes = 0;
+    std::chrono::nanoseconds decode_time{ 0 };
+  };
+
+  totals_t sum_entries(const std::vector<manifest_entry_t>& entries) {
+    totals_t totals;
+    for (const manifest_entry_t& e : entries) {
+      totals.files++;
+      totals.input_bytes += e.compressed_size;
+      totals.output_bytes += e.decoded_size;
+      totals.decode_time += e.decode_time;
+    }
+    return totals;
+  }
+
+  double ratio(std::uint64_t output_bytes, std::uint64_t input_bytes) {
+    return input_bytes ? double(output_bytes) / double(input_bytes) : 0.0;
+  }
+
+  // Bucket i of a codec_stats_t histogram holds the values with a bit width of i
+  std::string bucket_label(std::size_t bucket) {
+    if (bucket < 2) return std::to_string(bucket);
+    return std::format("{}-{}", std::uint64_t(1) << (bucket - 1), (std::uint64_t(1) << bucket) - 1);
+  }
+
+  std::string class_label(algorithm_t algorithm, unsigned token_class) {
+    std::string name = token_class_name(algorithm, token_class);
+    if (algorithm == algorithm_t::CDI || algorithm == algorithm_t::WIN) {
+      return std::format("0x{:X} {}", token_class, name);
+    }
+    return name;
+  }
+
+  std::string path_of(const manifest_entry_t& e, const std::filesystem::path& root) {
+    return (root.empty() ? e.path : e.path.lexically_relative(root)).generic_string();
+  }
+
+  void json_array(std::ostream& out, std::span<const std::uint64_t> values) {
+    out << "[";
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      out << (i == 0 ? "" : ", ") << values[i];
+    }
+    out << "]";
+  }
+}
+
+void decode_stats_t::add_codecs(std::span<const codec_stats_t> counted) {
+  for (std::size_t algo = 0; algo < counted.size(); ++algo) {
+    const codec_stats_t& s = counted[algo];
+    if (std::all_of(s.tokens.begin(), s.tokens.end(), [](std::uint64_t n) { return n == 0; })) continue;
+    codecs[static_cast<algorithm_t>(algo)].merge(s);
+  }
+}
+
+const char* BOLT::token_class_name(algorithm_t algorithm, unsigned token_class) {
+  std::span<const char* const> names;
+  switch (algorithm) {
+  case algorithm_t::CDI: names = CDI_CLASSES; break;
+  case algorithm_t::DOS: names = DOS_CLASSES; break;
+  case algorithm_t::N64:
+  case algorithm_t::XBOX: names = N64_CLASSES; break;
+  case algorithm_t::WIN: names = WIN_CLASSES; break;
+  default: break;
+  }
+  return token_class < names.size() ? names[token_class] : nullptr;
+}
+
+void BOLT::print_stats_summary(std::ostream& out, const decode_stats_t& stats, const std::filesystem::path& root) {
+  totals_t totals = sum_entries(stats.entries);
+  out << std::format("Decoded {} files: {:.2f} MiB in, {:.2f} MiB out, ratio {:.2f}, {:.1f} ms decoding\n",
+    totals.files, totals.input_bytes / 1048576.0, totals.output_bytes / 1048576.0, ratio(totals.output_bytes, totals.input_bytes),
+    std::chrono::duration<double, std::milli>(totals.decode_time).count());
+
+  for (const auto& [algorithm, s] : stats.codecs) {
+    std::uint64_t num_tokens = 0;
+    for (std::uint64_t n : s.tokens) num_tokens += n;
+
+    out << std::format("\n{:<20}{:>12}{:>8}{:>14}\n", std::format("{} tokens", algorithm_name(algorithm)), "count", "%", "out bytes");
+    for (unsigned c = 0; c < codec_stats_t::MAX_CLASSES; ++c) {
+      if (s.tokens[c] == 0) continue;
+      out << std::format("  {:<18}{:>12}{:>8.1f}{:>14}\n", class_label(algorithm, c), s.tokens[c], 100.0 * s.tokens[c] / num_tokens, s.token_bytes[c]);
+    }
+
+    out << std::format("\n{:<20}{:>12}{:>12}{:>12}{:>12}{:>12}\n", std::format("{} lengths", algorithm_name(algorithm)), KIND_NAMES[0], KIND_NAMES[1], KIND_NAMES[2], KIND_NAMES[3], "distance");
+    for (std::size_t b = 0; b < codec_stats_t::BUCKETS; ++b) {
+      std::uint64_t used = s.distances[b];
+      for (const auto& kind : s.lengths) used |= kind[b];
+      if (used == 0) continue;
+
+      out << std::format("  {:<18}{:>12}{:>12}{:>12}{:>12}{:>12}\n", bucket_label(b), s.lengths[0][b], s.lengths[1][b], s.lengths[2][b], s.lengths[3][b], s.distances[b]);
+    }
+  }
+
+  std::vector<const manifest_entry_t*> slowest;
+  for (const manifest_entry_t& e : stats.entries) slowest.push_back(&e);
+  std::size_t shown = std::min<std::size_t>(slowest.size(), 10);
+  std::partial_sort(slowest.begin(), slowest.begin() + shown, slowest.end(), [](const manifest_entry_t* a, const manifest_entry_t* b) { return a->decode_time > b->decode_time; });
+
+  if (shown == 0) return;
+  out << std::format("\n{:<30}{:>12}{:>12}{:>12}{:>8}\n", "slowest files", "decode us", "in bytes", "out bytes", "ratio");
+  for (std::size_t i = 0; i < shown; ++i) {
+    const manifest_entry_t& e = *slowest[i];
+    out << std::format("  {:<28}{:>12.1f}{:>12}{:>12}{:>8.2f}\n", path_of(e, root), e.decode_time.count() / 1000.0, e.compressed_size, e.decoded_size, ratio(e.decoded_size, e.compressed_size));
+  }
+}
+
+void BOLT::write_stats_json(std::ostream& out, const decode_stats_t& stats, const std::filesystem::path& root) {
+  totals_t totals = sum_entries(stats.entries);
+  out << std::format("{{\n  \"files\": {}, \"input_bytes\": {}, \"output_bytes\": {}, \"decode_us\": {:.1f},\n  \"codecs\": {{",
+    totals.files, totals.input_bytes, totals.output_bytes, totals.decode_time.count() / 1000.0);
+
+  bool first = true;
+  for (const auto& [algorithm, s] : stats.codecs) {
+    out << (first ? "\n" : ",\n") << "    \"" << algorithm_name(algorithm) << "\": {\n      \"tokens\": [";
+    first = false;
+
+    bool first_class = true;
+    for (unsigned c = 0; c < codec_stats_t::MAX_CLASSES; ++c) {
+      if (s.tokens[c] == 0) continue;
+      out << (first_class ? "\n" : ",\n")
+        << std::format("        {{\"class\": {}, \"name\": ", c) << json_string(token_class_name(algorithm, c))
+        << std::format(", \"count\": {}, \"bytes\": {}}}", s.tokens[c], s.token_bytes[c]);
+      first_class = false;
+    }
+
+    out << "\n      ],\n      \"lengths\": {";
+    for (std::size_t kind = 0; kind < s.lengths.size(); ++kind) {
+      out << (kind == 0 ? "\n" : ",\n") << "        \"" << KIND_NAMES[kind] << "\": ";
+      json_array(out, s.lengths[kind]);
+    }
+    out << "\n      },\n      \"distances\": ";
+    json_array(out, s.distances);
+    out << "\n    }";
+  }
+
+  out << "\n  },\n  \"entries\": [";
+  for (std::size_t i = 0; i < stats.entries.size(); ++i) {
+    const manifest_entry_t& e = stats.entries[i];
+    out << (i == 0 ? "\n" : ",\n") << "    {\"path\": " << json_string(path_of(e, root))
+      << std::format(", \"compressed_size\": {}, \"decoded_size\": {}, \"ratio\": {:.3f}, \"decode_us\": {:.1f}", e.compressed_size, e.decoded_size, ratio(e.decoded_size, e.compressed_size), e.decode_time.count() / 1000.0);
+    if (e.error) {
+      out << ", \"error\": " << json_string(e.error.message);
+    }
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <filesystem>
+#include <map>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "bolt.h"
+#include "codec.h"
+#include "manifest.h"
+
+
+namespace BOLT {
+  // Everything --stats collects over one run
+  struct decode_stats_t {
+    std::map<algorithm_t, codec_stats_t> codecs;
+    std::vector<manifest_entry_t> entries;  // every file that was decoded, with its sizes and decode time
+
+    // Adds what a decoder counted, indexed by algorithm_t like decoder_t::codec_stats()
+    void add_codecs(std::span<const codec_stats_t> counted);
+  };
+
+  // What a token class of codec_stats_t stands for in the algorithm, nullptr for classes it doesn't use
+  const char* token_class_name(algorithm_t algorithm, unsigned token_class);
+
+  // Totals, token and length tables per algorithm and the slowest files. Paths like write_stats_json.
+  void print_stats_summary(std::ostream& out, const decode_stats_t& stats, const std::filesystem::path& root);
+
+  // The same as JSON, with every file. Paths are written relative to root, unless it is empty.
+  void write_stats_json(std::ostream& out, const decode_stats_t& stats, const std::filesystem::path& root);
+}
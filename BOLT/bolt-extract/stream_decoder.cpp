@@ -0,0 +1,33 @@
+#include <stdexcept>
+
+#include "stream_decoder.h"
+
+
+using namespace BOLT;
+
+std::unique_ptr<entry_stream_t> BOLT::open_entry_stream(std::span<const std::byte> rom, std::size_t bolt_begin, const entry_t& entry, algorithm_t algorithm, std::endian byte_order, std::size_t chunk_size) {
+  std::size_t size = entry.uncompressed_size(byte_order);
+  std::size_t offset = entry.data_offset(byte_order);
+  if (bolt_begin + offset > rom.size() || ((entry.flags & FLAG_UNCOMPRESSED) && size > rom.size() - bolt_begin - offset)) {
+    throw std::runtime_error("Entry data lies outside the rom");
+  }
+  std::span<const std::byte> input = rom.subspan(bolt_begin + offset);
+
+  if (entry.flags & FLAG_UNCOMPRESSED) {
+    return std::make_unique<stored_stream_t>(input.first(size));
+  }
+
+  switch (algorithm) {
+  case algorithm_t::CDI:
+    return std::make_unique<stream_decoder_t<cdi_codec_t<checked_t>>>(input, size, chunk_size);
+  case algorithm_t::DOS:
+    return std::make_unique<stream_decoder_t<dos_codec_t<checked_t>>>(input, size, chunk_size);
+  case algorithm_t::N64:
+  case algorithm_t::XBOX:
+    return std::make_unique<stream_decoder_t<n64_codec_t<checked_t>>>(input, size, chunk_size);
+  case algorithm_t::WIN:
+    return std::make_unique<stream_decoder_t<win_codec_t<checked_t>>>(input, size, chunk_size);
+  default:
+    throw std::runtime_error("Can't stream without a known algorithm");
+  }
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <span>
+
+#include "bolt.h"
+#include "codec.h"
+
+
+namespace BOLT {
+  // Pull based access to one entry's data. Memory use is bounded by the codec window plus the
+  // chunk size, regardless of how large the entry is.
+  class entry_stream_t {
+  protected:
+    std::size_t total = 0;
+    std::size_t produced = 0;
+    decode_error_t error;
+
+  public:
+    // Fills as much of chunk as the entry has left, 0 means the entry is done
+    virtual std::size_t read(std::span<std::byte> chunk) = 0;
+
+    std::size_t size() const { return total; }
+    std::size_t position() const { return produced; }
+    bool failed() const { return bool(error); }
+    const char* error_message() const { return error.message; }
+    const decode_error_t& last_error() const { return error; }
+
+    virtual ~entry_stream_t() = default;
+  };
+
+  // Stored entries, just hands out the rom bytes
+  class stored_stream_t : public entry_stream_t {
+  private:
+    std::span<const std::byte> data;
+
+  public:
+    std::size_t read(std::span<std::byte> chunk) override {
+      std::size_t n = std::min(chunk.size(), data.size() - produced);
+      std::memcpy(chunk.data(), data.data() + produced, n);
+      produced += n;
+      return n;
+    }
+
+    explicit stored_stream_t(std::span<const std::byte> data) : data(data) {
+      total = data.size();
+    }
+  };
+
+  // Decodes into a sliding buffer. Once it is full, the last window_size bytes move to the front so
+  // back references keep working, and decoding picks up where the codec left off.
+  template<class codec_t>
+  class stream_decoder_t : public entry_stream_t {
+  private:
+    codec_t codec;
+    std::size_t window_size;
+
+    std::vector<std::byte> buffer;
+    std::size_t fill = 0;      // decoded bytes in buffer
+    std::size_t read_pos = 0;  // of those, already handed out
+    bool done = false;
+
+    void slide() {
+      std::size_t keep = std::min(window_size, fill);
+      std::memmove(buffer.data(), buffer.data() + fill - keep, keep);
+      fill = keep;
+      read_pos = keep;
+    }
+
+    void decode_more() {
+      if (fill == buffer.size()) slide();
+
+      std::size_t decoded = produced_total();
+      std::size_t end = std::min(buffer.size(), fill + (total - decoded));
+      output_window_t out{ buffer.data(), buffer.data() + fill, buffer.data() + end };
+
+      decode_status_t status = codec.run(out);
+      fill = out.dst - out.begin;
+
+      if (status == decode_status_t::ERROR) {
+        // The codec counts from the start of the buffer, which is this far into the entry
+        error = codec.last_error();
+        error.output_pos += produced - read_pos;
+        done = true;
+      }
+      else if (status == decode_status_t::END_OF_STREAM && produced_total() != total) {
+        error = { decode_error_kind_t::SIZE_MISMATCH, "finished decompression with invalid size", codec.input_position(), produced_total(), codec.last_opcode() };
+        done = true;
+      }
+      else if (status == decode_status_t::END_OF_STREAM || produced_total() == total) {
+        // Whatever is still pending runs past the expected size and is cut off, reported like decoder_t does
+        if (codec.has_pending()) {
+          error = { decode_error_kind_t::TRUNCATED, "run goes past the expected size, truncating", codec.input_position(), produced_total(), codec.last_opcode() };
+        }
+        done = true;
+      }
+    }
+
+    // Bytes decoded so far, handed out or not
+    std::size_t produced_total() const { return produced + (fill - read_pos); }
+
+  public:
+    std::size_t read(std::span<std::byte> chunk) override {
+      std::size_t copied = 0;
+      while (copied < chunk.size()) {
+        if (read_pos == fill) {
+          if (done) break;
+          decode_more();
+          continue;
+        }
+
+        std::size_t n = std::min(chunk.size() - copied, fill - read_pos);
+        std::memcpy(chunk.data() + copied, buffer.data() + read_pos, n);
+        read_pos += n;
+        produced += n;
+        copied += n;
+      }
+      return copied;
+    }
+
+    stream_decoder_t(std::span<const std::byte> input, std::size_t uncompressed_size, std::size_t chunk_size, std::size_t window_size = codec_t::WINDOW_SIZE)
+      : codec(input), window_size(window_size), buffer(std::min(uncompressed_size, window_size + chunk_size)) {
+      total = uncompressed_size;
+      if (total == 0) done = true;
+    }
+  };
+
+  // Stream for any entry of an archive that starts at bolt_begin. chunk_size is only a hint for how
+  // much to decode per call, reads of any size work.
+  std::unique_ptr<entry_stream_t> open_entry_stream(std::span<const std::byte> rom, std::size_t bolt_begin, const entry_t& entry, algorithm_t algorithm, std::endian byte_order, std::size_t chunk_size = 64 * 1024);
+}
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "stream_sink.h"
+
+
+using namespace BOLT;
+
+namespace {
+  constexpr std::size_t STREAM_BUFFER_SIZE = 1024 * 1024;
+
+  // Right aligned octal, zero padded to width - 1 digits and NUL terminated, like tar writes them
+  bool put_octal(char* field, std::size_t width, std::uint64_t value) {
+    for (std::size_t i = width - 1; i-- > 0; ) {
+      field[i] = char('0' + (value & 7));
+      value >>= 3;
+    }
+    field[width - 1] = '\0';
+    return value == 0;
+  }
+
+#pragma pack(push, 1)
+  struct ustar_header_t {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char checksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char padding[12];
+  };
+#pragma pack(pop)
+  static_assert(sizeof(ustar_header_t) == 512);
+
+  // Names over 100 characters go into prefix, split at a slash
+  bool split_ustar_name(const std::string& name, ustar_header_t& header) {
+    if (name.size() <= sizeof(header.name)) {
+      std::memcpy(header.name, name.data(), name.size());
+      return true;
+    }
+
+    std::size_t split = name.rfind('/', sizeof(header.prefix));
+    if (split == std::string::npos || split == 0 || name.size() - split - 1 > sizeof(header.name)) return false;
+
+    std::memcpy(header.prefix, name.data(), split);
+    std::memcpy(header.name, name.data() + split + 1, name.size() - split - 1);
+    return true;
+  }
+}
+
+std::FILE* BOLT::open_output_file(const std::filesystem::path& output) {
+  if (output == "-") {
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    return stdout;
+  }
+#ifdef _WIN32
+  return _wfopen(output.c_str(), L"wb");
+#else
+  return std::fopen(output.c_str(), "wb");
+#endif
+}
+
+stream_sink_t::stream_sink_t(const std::filesystem::path& output, std::filesystem::path root)
+  : root(std::move(root)) {
+  out = open_output_file(output);
+  if (out == nullptr) {
+    throw std::runtime_error("Can't open " + output.string() + " for writing");
+  }
+  owns_out = out != stdout;
+
+  buffer.resize(STREAM_BUFFER_SIZE);
+  std::setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+
+  // Every entry gets the time of the extraction, there's nothing better to go by
+  mtime = static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+stream_sink_t::~stream_sink_t() {
+  if (owns_out) {
+    std::fclose(out);
+  }
+  else {
+    std::fflush(out);
+    std::setvbuf(out, nullptr, _IOFBF, BUFSIZ);
+  }
+}
+
+void stream_sink_t::put(const void* data, std::size_t size) {
+  if (size == 0 || failed) return;
+  if (std::fwrite(data, 1, size, out) != size) {
+    failed = true;
+    std::cerr << "Failed to write the archive stream\n";
+  }
+  position += size;
+}
+
+void stream_sink_t::pad_to(std::size_t alignment) {
+  static const char zeros[512] = {};
+  std::size_t pad = (alignment - position % alignment) % alignment;
+  // The tar trailer pads to 10 KiB, more than one block of zeros
+  for (; pad > sizeof(zeros); pad -= sizeof(zeros)) {
+    put(zeros, sizeof(zeros));
+  }
+  put(zeros, pad);
+}
+
+// Directory entries for every ancestor of name that doesn't have one yet, outermost first
+bool stream_sink_t::emit_parents(const std::string& name) {
+  for (std::size_t slash = name.find('/'); slash != std::string::npos; slash = name.find('/', slash + 1)) {
+    std::string dir = name.substr(0, slash);
+    if (emitted_dirs.insert(dir).second) {
+      if (!write_header(dir, 0, true)) return false;
+    }
+  }
+  return true;
+}
+
+bool stream_sink_t::write_file(const std::filesystem::path& filename, std::span<const std::byte> data) {
+  std::string name = filename.lexically_relative(root).generic_string();
+  if (!emit_parents(name) || !write_header(name, data.size(), false)) {
+    std::cerr << "Can't store " << name << " in the archive stream\n";
+    return false;
+  }
+  put(data.data(), data.size());
+  pad_to(data_alignment());
+  return !failed;
+}
+
+bool stream_sink_t::link_file(const std::filesystem::path& filename, const std::filesystem::path& target) {
+  std::string name = filename.lexically_relative(root).generic_string();
+  if (!emit_parents(name)) return false;
+  return write_link_header(name, target.lexically_relative(root).generic_string()) && !failed;
+}
+
+bool stream_sink_t::add_directory(const std::filesystem::path& dir) {
+  std::string name = dir.lexically_relative(root).generic_string();
+  if (name.empty() || name == ".") return true;
+  return emit_parents(name + "/") && !failed;
+}
+
+bool stream_sink_t::finish() {
+  write_trailer();
+  if (std::fflush(out) != 0 && !failed) {
+    failed = true;
+    std::cerr << "Failed to write the archive stream\n";
+  }
+  return !failed;
+}
+
+bool tar_sink_t::write_header(const std::string& name, std::uint64_t size, bool is_dir) {
+  return is_dir ? put_header(name + "/", 0, '5', {}) : put_header(name, size, '0', {});
+}
+
+bool tar_sink_t::write_link_header(const std::string& name, const std::string& target) {
+  return put_header(name, 0, '1', target);
+}
+
+bool tar_sink_t::put_header(const std::string& name, std::uint64_t size, char typeflag, const std::string& linkname) {
+  ustar_header_t header = {};
+  if (!split_ustar_name(name, header)) return false;
+  if (linkname.size() > sizeof(header.linkname)) return false;
+
+  put_octal(header.mode, sizeof(header.mode), typeflag == '5' ? 0755 : 0644);
+  put_octal(header.uid, sizeof(header.uid), 0);
+  put_octal(header.gid, sizeof(header.gid), 0);
+  if (!put_octal(header.size, sizeof(header.size), size)) return false;
+  put_octal(header.mtime, sizeof(header.mtime), mtime);
+  header.typeflag = typeflag;
+  std::memcpy(header.linkname, linkname.data(), linkname.size());
+  std::memcpy(header.magic, "ustar", 6);
+  std::memcpy(header.version, "00", 2);
+
+  // Summed with the checksum field itself as spaces
+  std::memset(header.checksum, ' ', sizeof(header.checksum));
+  unsigned sum = 0;
+  for (unsigned char c : std::span(reinterpret_cast<const unsigned char*>(&header), sizeof(header))) {
+    sum += c;
+  }
+  put_octal(header.checksum, 7, sum);
+  header.checksum[7] = ' ';
+
+  put(&header, sizeof(header));
+  return true;
+}
+
+void tar_sink_t::write_trailer() {
+  // Two empty records, then padding to the usual 10 KiB blocking
+  static const char zeros[1024] = {};
+  put(zeros, sizeof(zeros));
+  pad_to(10240);
+}
+
+bool cpio_sink_t::write_header(const std::string& name, std::uint64_t size, bool is_dir) {
+  if (size > 0xFFFFFFFF) return false;
+
+  std::uint32_t mode = is_dir ? 040755 : 0100644;
+  std::uint32_t nlink = is_dir ? 2 : 1;
+  std::string header = std::format("070701{:08X}{:08X}{:08X}{:08X}{:08X}{:08X}{:08X}{:08X}{:08X}{:08X}{:08X}{:08X}{:08X}",
+    next_inode++, mode, 0, 0, nlink, mtime, std::uint32_t(size), 0, 0, 0, 0, std::uint32_t(name.size() + 1), 0);
+
+  put(header.data(), header.size());
+  put(name.c_str(), name.size() + 1);
+  pad_to(4);
+  return true;
+}
+
+void cpio_sink_t::write_trailer() {
+  write_header("TRAILER!!!", 0, false);
+  pad_to(512);
+}
+
+std::unique_ptr<output_sink_t> BOLT::open_stream_sink(stream_format_t format, const std::filesystem::path& output, const std::filesystem::path& root) {
+  switch (format) {
+  case stream_format_t::CPIO:
+    return std::make_unique<cpio_sink_t>(output, root);
+  default:
+    return std::make_unique<tar_sink_t>(output, root);
+  }
+}
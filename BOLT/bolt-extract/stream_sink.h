@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "output_writer.h"
+
+
+namespace BOLT {
+  enum class stream_format_t {
+    TAR,   // POSIX ustar
+    CPIO,  // SVR4 "newc", without CRC
+  };
+
+  // The whole extracted tree as one archive, written front to back so the output can be a pipe.
+  // Names are relative to root, and every directory gets its entry ahead of the first file in it.
+  class stream_sink_t : public output_sink_t {
+  private:
+    std::FILE* out = nullptr;
+    bool owns_out = false;
+    std::vector<char> buffer;
+
+    std::filesystem::path root;
+    std::unordered_set<std::string> emitted_dirs;
+    bool failed = false;
+
+    bool emit_parents(const std::string& name);
+
+  protected:
+    std::uint64_t position = 0;
+    std::uint32_t mtime;
+
+    void put(const void* data, std::size_t size);
+    void pad_to(std::size_t alignment);
+
+    virtual bool write_header(const std::string& name, std::uint64_t size, bool is_dir) = 0;
+    virtual void write_trailer() = 0;
+    virtual std::size_t data_alignment() const = 0;
+
+    // An entry without data that links name to target, for formats that have one
+    virtual bool write_link_header(const std::string& name, const std::string& target) { return false; }
+
+  public:
+    bool write_file(const std::filesystem::path& filename, std::span<const std::byte> data) override;
+    bool add_directory(const std::filesystem::path& dir) override;
+    bool link_file(const std::filesystem::path& filename, const std::filesystem::path& target) override;
+    bool finish() override;
+
+    // "-" writes to stdout
+    stream_sink_t(const std::filesystem::path& output, std::filesystem::path root);
+    ~stream_sink_t();
+  };
+
+  class tar_sink_t : public stream_sink_t {
+  private:
+    bool put_header(const std::string& name, std::uint64_t size, char typeflag, const std::string& linkname);
+
+  protected:
+    bool write_header(const std::string& name, std::uint64_t size, bool is_dir) override;
+    bool write_link_header(const std::string& name, const std::string& target) override;
+    void write_trailer() override;
+    std::size_t data_alignment() const override { return 512; }
+
+  public:
+    using stream_sink_t::stream_sink_t;
+  };
+
+  class cpio_sink_t : public stream_sink_t {
+  private:
+    std::uint32_t next_inode = 1;
+
+  protected:
+    bool write_header(const std::string& name, std::uint64_t size, bool is_dir) override;
+    void write_trailer() override;
+    std::size_t data_alignment() const override { return 4; }
+
+  public:
+    using stream_sink_t::stream_sink_t;
+  };
+
+  // Opened for binary writing, - is stdout. Null if it can't be opened.
+  std::FILE* open_output_file(const std::filesystem::path& output);
+
+  // Throws if output can't be opened
+  std::unique_ptr<output_sink_t> open_stream_sink(stream_format_t format, const std::filesystem::path& output, const std::filesystem::path& root);
+}
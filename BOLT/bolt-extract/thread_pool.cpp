@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "thread_pool.h"
+
+
+using namespace BOLT;
+
+thread_pool_t::thread_pool_t(unsigned num_threads) {
+  if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned i = 0; i < num_threads; ++i) {
+    queues.push_back(std::make_unique<worker_queue_t>());
+  }
+  for (unsigned i = 0; i < num_threads; ++i) {
+    threads.emplace_back(&thread_pool_t::worker_main, this, i);
+  }
+}
+
+thread_pool_t::~thread_pool_t() {
+  {
+    std::lock_guard guard{ state_lock };
+    stopping = true;
+  }
+  work_available.notify_all();
+
+  for (std::thread& t : threads) {
+    t.join();
+  }
+}
+
+void thread_pool_t::submit(task_t task) {
+  std::vector<task_t> tasks;
+  tasks.push_back(std::move(task));
+  submit(std::move(tasks));
+}
+
+void thread_pool_t::submit(std::vector<task_t> tasks) {
+  if (tasks.empty()) return;
+
+  std::size_t start;
+  {
+    std::lock_guard guard{ state_lock };
+    start = next_queue;
+    next_queue = (next_queue + tasks.size()) % queues.size();
+  }
+
+  for (std::size_t i = 0; i < tasks.size(); ++i) {
+    worker_queue_t& queue = *queues[(start + i) % queues.size()];
+    std::lock_guard guard{ queue.lock };
+    queue.tasks.push_back(std::move(tasks[i]));
+  }
+
+  {
+    std::lock_guard guard{ state_lock };
+    queued += tasks.size();
+    unfinished += tasks.size();
+  }
+  work_available.notify_all();
+}
+
+void thread_pool_t::wait() {
+  std::unique_lock guard{ state_lock };
+  all_done.wait(guard, [this] { return unfinished == 0; });
+
+  if (first_error) {
+    std::exception_ptr error = first_error;
+    first_error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+bool thread_pool_t::try_pop(unsigned worker, task_t& task) {
+  {
+    worker_queue_t& own = *queues[worker];
+    std::lock_guard guard{ own.lock };
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.front());
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+
+  for (std::size_t i = 1; i < queues.size(); ++i) {
+    worker_queue_t& victim = *queues[(worker + i) % queues.size()];
+    std::lock_guard guard{ victim.lock };
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.back());
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void thread_pool_t::worker_main(unsigned worker) {
+  for (;;) {
+    {
+      std::unique_lock guard{ state_lock };
+      work_available.wait(guard, [this] { return stopping || queued != 0; });
+      if (queued == 0) return;  // stopping with nothing left to do
+      queued--;
+    }
+
+    // A task counted in `queued` is in some deque, but another worker may have taken it first; keep looking
+    task_t task;
+    while (!try_pop(worker, task)) {
+      std::this_thread::yield();
+    }
+
+    try {
+      task(worker);
+    }
+    catch (...) {
+      std::lock_guard guard{ state_lock };
+      if (!first_error) first_error = std::current_exception();
+    }
+
+    {
+      std::lock_guard guard{ state_lock };
+      unfinished--;
+      if (unfinished == 0) all_done.notify_all();
+    }
+  }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+
+
+namespace BOLT {
+  // Fixed size work-stealing pool. Each worker owns a deque, pops from its front and
+  // steals from the back of the other workers' deques when it runs dry.
+  class thread_pool_t {
+  public:
+    using task_t = std::function<void(unsigned worker)>;
+
+  private:
+    struct worker_queue_t {
+      std::mutex lock;
+      std::deque<task_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<worker_queue_t>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex state_lock;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    std::size_t queued = 0;
+    std::size_t unfinished = 0;
+    std::size_t next_queue = 0;
+    bool stopping = false;
+
+    std::exception_ptr first_error;
+
+    bool try_pop(unsigned worker, task_t& task);
+    void worker_main(unsigned worker);
+
+  public:
+    // Tasks are dealt round-robin in submission order, so submitting the most expensive ones first
+    // has every worker start on a big one.
+    void submit(task_t task);
+    void submit(std::vector<task_t> tasks);
+
+    // Blocks until every submitted task finished. Rethrows the first exception a task threw.
+    void wait();
+
+    unsigned size() const { return static_cast<unsigned>(threads.size()); }
+
+    // 0 uses every hardware thread
+    explicit thread_pool_t(unsigned num_threads);
+    thread_pool_t(const thread_pool_t&) = delete;
+    thread_pool_t& operator=(const thread_pool_t&) = delete;
+    ~thread_pool_t();
+  };
+}
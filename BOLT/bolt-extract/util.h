@@ -1,35 +1,93 @@
-#pragma once
-#include <vector>
-
-
-namespace BOLT {
-  extern bool g_big_endian;
-}
-
-inline void reinsert_self(std::vector<std::byte>& result, unsigned rel_offset, unsigned run_length) {
-  for (unsigned i = 0; i < run_length; i++) {
-    std::byte v = result[result.size() - rel_offset];
-    result.push_back(v);
-  }
-}
-
-inline std::uint32_t bswap_if(std::uint32_t v) {
-  if (BOLT::g_big_endian) {
-    return
-      ((v & 0x000000FF) << 24) |
-      ((v & 0x0000FF00) << 8) |
-      ((v & 0x00FF0000) >> 8) |
-      ((v & 0xFF000000) >> 24);
-  }
-  return v;
-}
-
-inline std::uint16_t bswap_if(std::uint16_t v) {
-  if (BOLT::g_big_endian) {
-    return
-      ((v & 0x00FF) << 8) |
-      ((v & 0xFF00) >> 8);
-  }
-  return v;
-}
-
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <span>
+#include <type_traits>
+
+#include "match_copy.h"
+
+
+// Copies run_length bytes from rel_offset behind the write position, source and destination may overlap
+inline void reinsert_self(std::byte*& dst, unsigned rel_offset, unsigned run_length) {
+  if (run_length >= BOLT::MATCH_KERNEL_MIN) {
+    BOLT::g_match_kernels.copy(dst, rel_offset, run_length);
+  }
+  else {
+    const std::byte* src = dst - rel_offset;
+    for (unsigned i = 0; i < run_length; i++) {
+      dst[i] = src[i];
+    }
+  }
+  dst += run_length;
+}
+
+// Copies run_length bytes walking backwards from rel_offset behind the write position
+inline void reinsert_reversed(std::byte*& dst, unsigned rel_offset, unsigned run_length) {
+  const std::byte* src_last = dst - rel_offset;
+  if (run_length >= BOLT::MATCH_KERNEL_MIN) {
+    BOLT::g_match_kernels.reverse(dst, src_last, run_length);
+  }
+  else {
+    for (unsigned i = 0; i < run_length; i++) {
+      dst[i] = *(src_last - i);
+    }
+  }
+  dst += run_length;
+}
+
+// std::byteswap is C++23, this covers the widths the archive formats use
+template<class T>
+constexpr T byteswap(T v) {
+  static_assert(std::is_unsigned_v<T> && sizeof(T) <= 4);
+  if constexpr (sizeof(T) == 4) {
+    return
+      ((v & 0x000000FF) << 24) |
+      ((v & 0x0000FF00) << 8) |
+      ((v & 0x00FF0000) >> 8) |
+      ((v & 0xFF000000) >> 24);
+  }
+  else if constexpr (sizeof(T) == 2) {
+    return T(((v & 0x00FF) << 8) | ((v & 0xFF00) >> 8));
+  }
+  return v;
+}
+
+// Converts a value stored in byte order `order` to the host's, or back. No branch at runtime.
+template<std::endian order, class T>
+constexpr T from_endian(T v) {
+  if constexpr (order == std::endian::native) {
+    return v;
+  }
+  return byteswap(v);
+}
+
+// Same with the order only known at runtime, for the odd header field. Loops over entries should
+// go through with_byte_order instead.
+inline std::uint32_t bswap_if(std::uint32_t v, std::endian order) {
+  return order == std::endian::native ? v : byteswap(v);
+}
+
+inline std::uint16_t bswap_if(std::uint16_t v, std::endian order) {
+  return order == std::endian::native ? v : byteswap(v);
+}
+
+// Calls fn with the byte order as a compile-time constant, std::integral_constant<std::endian, ...>,
+// so whatever fn does only branches on the order this once
+template<class fn_t>
+decltype(auto) with_byte_order(std::endian order, fn_t&& fn) {
+  if (order == std::endian::big) {
+    return fn(std::integral_constant<std::endian, std::endian::big>{});
+  }
+  return fn(std::integral_constant<std::endian, std::endian::little>{});
+}
+
+// FNV-1a, good enough to tell entries apart and stable across platforms
+inline std::uint64_t fnv1a_64(std::span<const std::byte> data) {
+  std::uint64_t hash = 0xCBF29CE484222325ull;
+  for (std::byte b : data) {
+    hash ^= std::to_integer<std::uint64_t>(b);
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
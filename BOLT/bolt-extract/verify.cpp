@@ -0,0 +1,60 @@
+#include <chrono>
+#include <format>
+#include <iterator>
+#include <memory>
+
+#include "verify.h"
+#include "manifest.h"
+
+
+using namespace BOLT;
+
+namespace {
+  std::string describe_failure(const manifest_entry_t& e) {
+    if (!e.error) {
+      return std::format("decoded {} bytes, expected {}", e.decoded_size, e.uncompressed_size);
+    }
+
+    const decode_error_t& error = e.error;
+    return std::format("{}: {} (input +0x{:X}, output {} of {}, opcode 0x{:02X})", error_kind_name(error.kind), error.message,
+      error.input_pos, error.output_pos, e.uncompressed_size, unsigned(error.opcode));
+  }
+}
+
+bool BOLT::verify_batch(const std::vector<batch_input_t>& inputs, extract_options_t options, const std::filesystem::path& root, std::ostream& out) {
+  std::vector<manifest_entry_t> rows;
+  std::vector<manifest_entry_t>* manifest = options.manifest;
+  options.manifest = &rows;
+  options.sink = std::make_unique<null_sink_t>();
+  options.quiet = true;
+
+  auto start = std::chrono::steady_clock::now();
+  bool ok = extract_batch(inputs, std::move(options));
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::size_t failed = 0;
+  std::uint64_t input_bytes = 0;
+  std::uint64_t output_bytes = 0;
+  std::chrono::nanoseconds decode_time{ 0 };
+  for (const manifest_entry_t& e : rows) {
+    input_bytes += e.compressed_size;
+    output_bytes += e.decoded_size;
+    decode_time += e.decode_time;
+    if (!e.error && e.decoded_size == e.uncompressed_size) continue;
+
+    failed++;
+    std::filesystem::path path = root.empty() ? e.path : e.path.lexically_relative(root);
+    out << path.generic_string() << ": " << describe_failure(e) << "\n";
+  }
+
+  // Decode time is summed over every worker, so that rate is per core
+  double decode_seconds = std::chrono::duration<double>(decode_time).count();
+  out << std::format("Verified {} files, {} failed: {:.2f} MiB in, {:.2f} MiB out in {:.3f} s, {:.1f} MB/s overall, {:.1f} MB/s per core decoding\n",
+    rows.size(), failed, input_bytes / 1048576.0, output_bytes / 1048576.0, seconds,
+    seconds > 0 ? output_bytes / seconds / 1e6 : 0.0, decode_seconds > 0 ? output_bytes / decode_seconds / 1e6 : 0.0);
+
+  if (manifest) {
+    manifest->insert(manifest->end(), std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+  }
+  return ok && failed == 0;
+}
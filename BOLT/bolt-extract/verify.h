@@ -0,0 +1,14 @@
+#pragma once
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+#include "bolt.h"
+
+
+namespace BOLT {
+  // --verify: extracts every input into a null sink, so nothing touches the disk. Lists every file
+  // that failed to decode or came out the wrong size, then the throughput. Paths are relative to
+  // root like in a manifest. False if anything failed.
+  bool verify_batch(const std::vector<batch_input_t>& inputs, extract_options_t options, const std::filesystem::path& root, std::ostream& out);
+}
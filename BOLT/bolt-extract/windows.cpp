@@ -1,86 +1,110 @@
-#include "bolt.h"
-#include "util.h"
-
-using namespace BOLT;
-
-
-// Decompress algorithm used by The Game of Life and ???.
-void bolt_reader_t::decompress_win(std::uint32_t offset, std::uint32_t expected_size, std::vector<std::byte>& result) {
-  set_cur_pos(offset);
-
-  while (result.size() < expected_size) {
-    std::uint8_t bytevalue = static_cast<std::uint8_t>(read_u8());
-
-    switch (bytevalue >> 4) {
-    case 0x0:
-      if (bytevalue) {
-        for (unsigned i = 0; i < bytevalue; ++i) {
-          result.push_back(read_u8());
-        }
-        continue;
-      }
-
-      if (result.size() != expected_size) {
-        std::ostringstream ss;
-        ss << "finished decompression with invalid size; Expected size: " << expected_size << "; Got: " << result.size();
-        err_msg(ss.str(), bytevalue);
-      }
-      return;
-    case 0x1: {
-      std::byte v = result[result.size() - ((bytevalue & 0xF) + 9)];
-      result.push_back(v);
-      result.push_back(v);
-      break;
-    }
-    case 0x2:
-    case 0x3: {
-      std::uint8_t b2 = std::uint8_t(read_u8());
-      unsigned run_length = (bytevalue & 0xF) + 3;
-      unsigned rel_offset = 2 * b2 + ((bytevalue >> 4) & 1);
-      reinsert_self(result, rel_offset, run_length);
-      break;
-    }
-    case 0x4: {
-      std::byte repeat_byte = read_u8();
-      unsigned run_length = (bytevalue & 0xF) + 3;
-      result.insert(result.end(), run_length, repeat_byte);
-      break;
-    }
-    case 0x5: {
-      std::uint8_t b2 = std::uint8_t(read_u8());
-      std::byte repeat_byte = read_u8();
-
-      unsigned run_length = 4 * (16 * b2 + (bytevalue & 0xF)) + 19;
-      result.insert(result.end(), run_length, repeat_byte);
-      break;
-    }
-    case 0x6: {
-      unsigned run_length = (bytevalue & 0xF) + 2;
-      result.insert(result.end(), run_length, std::byte(0));
-      break;
-    }
-    case 0x7:
-    case 0x8:
-    case 0x9:
-    case 0xA:
-    case 0xB:
-      result.push_back(result[result.size() - (bytevalue - 103)]);
-      result.push_back(result[result.size() - (bytevalue - 103)]);
-      break;
-    case 0xC:
-    case 0xD:
-    case 0xE:
-    case 0xF: {
-      result.push_back(result[result.size() - (((bytevalue & 0x38) >> 3) + 1)]);
-      result.push_back(result[result.size() - ((bytevalue & 7) + 2)]);
-      break;
-    }
-    }
-  }
-}
-
-// The Game of Life filetype 0x09, DOS games have something similar for 0x08
-void bolt_reader_t::decompress_win_special_9(std::uint32_t offset, std::uint32_t expected_size, std::vector<std::byte>& result) {
-  decompress_win(offset, 24, result);
-  // TODO multichunk entry
-}
+#include "codec.h"
+#include "decoder.h"
+
+using namespace BOLT;
+
+
+// Decompress algorithm used by The Game of Life and ???.
+template<class check_t>
+decode_status_t win_codec_t<check_t>::run(output_window_t& out) {
+  if (!flush_pending(out)) return decode_status_t::OUTPUT_FULL;
+
+  while (out.dst < out.end) {
+    if (!has_input<check_t>(1)) return fail_input(out);
+    std::uint8_t bytevalue = static_cast<std::uint8_t>(read_u8());
+    opcode = bytevalue;
+
+    bool fits = true;
+    switch (bytevalue >> 4) {
+    case 0x0:
+      if (bytevalue) {
+        if (!has_input<check_t>(bytevalue)) return fail_input(out);
+        count<check_t>(bytevalue >> 4, op_kind_t::LITERAL, bytevalue);
+        fits = emit_literal(out, bytevalue);
+        break;
+      }
+      return decode_status_t::END_OF_STREAM;
+    case 0x1: {
+      if (!has_lookbehind<check_t>(out, (bytevalue & 0xF) + 9)) return fail_lookbehind(out);
+      std::byte v = *(out.dst - ((bytevalue & 0xF) + 9));
+      count<check_t>(bytevalue >> 4, op_kind_t::FILL, 2);
+      fits = emit_fill(out, v, 2);
+      break;
+    }
+    case 0x2:
+    case 0x3: {
+      if (!has_input<check_t>(1)) return fail_input(out);
+      std::uint8_t b2 = std::uint8_t(read_u8());
+      unsigned run_length = (bytevalue & 0xF) + 3;
+      unsigned rel_offset = 2 * b2 + ((bytevalue >> 4) & 1);
+      if (!has_lookbehind<check_t>(out, rel_offset)) return fail_lookbehind(out);
+      count<check_t>(bytevalue >> 4, op_kind_t::MATCH, run_length, rel_offset);
+      fits = emit_match(out, rel_offset, run_length);
+      break;
+    }
+    case 0x4: {
+      if (!has_input<check_t>(1)) return fail_input(out);
+      std::byte repeat_byte = read_u8();
+      unsigned run_length = (bytevalue & 0xF) + 3;
+      count<check_t>(bytevalue >> 4, op_kind_t::FILL, run_length);
+      fits = emit_fill(out, repeat_byte, run_length);
+      break;
+    }
+    case 0x5: {
+      if (!has_input<check_t>(2)) return fail_input(out);
+      std::uint8_t b2 = std::uint8_t(read_u8());
+      std::byte repeat_byte = read_u8();
+
+      unsigned run_length = 4 * (16 * b2 + (bytevalue & 0xF)) + 19;
+      count<check_t>(bytevalue >> 4, op_kind_t::FILL, run_length);
+      fits = emit_fill(out, repeat_byte, run_length);
+      break;
+    }
+    case 0x6: {
+      unsigned run_length = (bytevalue & 0xF) + 2;
+      count<check_t>(bytevalue >> 4, op_kind_t::FILL, run_length);
+      fits = emit_fill(out, std::byte(0), run_length);
+      break;
+    }
+    case 0x7:
+    case 0x8:
+    case 0x9:
+    case 0xA:
+    case 0xB: {
+      unsigned rel_offset = bytevalue - 103;
+      if (!has_lookbehind<check_t>(out, rel_offset)) return fail_lookbehind(out);
+      count<check_t>(bytevalue >> 4, op_kind_t::MATCH, 2, rel_offset);
+      fits = emit_match(out, rel_offset, 2);
+      break;
+    }
+    case 0xC:
+    case 0xD:
+    case 0xE:
+    case 0xF: {
+      // Two single byte copies, the second one is relative to the position after the first
+      unsigned first_offset = ((bytevalue & 0x38) >> 3) + 1;
+      unsigned second_offset = (bytevalue & 7) + 2;
+      if (!has_lookbehind<check_t>(out, second_offset - 1)) return fail_lookbehind(out);
+      if (!has_lookbehind<check_t>(out, first_offset)) return fail_lookbehind(out);
+      count<check_t>(bytevalue >> 4, op_kind_t::MATCH, 1, first_offset);
+      fits = emit_match(out, first_offset, 1);
+      count<check_t>(bytevalue >> 4, op_kind_t::MATCH, 1, second_offset);
+      fits = emit_match(out, second_offset, 1) && fits;
+      break;
+    }
+    }
+
+    if (!fits) return decode_status_t::OUTPUT_FULL;
+  }
+  return decode_status_t::OUTPUT_FULL;
+}
+
+template class BOLT::win_codec_t<checked_t>;
+template class BOLT::win_codec_t<unchecked_t>;
+template class BOLT::win_codec_t<counted_t>;
+
+// The Game of Life filetype 0x09, DOS games have something similar for 0x08
+std::size_t decoder_t::decompress_win_special_9(std::uint32_t offset, std::span<std::byte> out) {
+  return decompress<win_codec_t<checked_t>>(offset, out.first(24));
+  // TODO multichunk entry
+}